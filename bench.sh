@@ -0,0 +1,112 @@
+#!/bin/sh
+#-----------------------------------------------------------------#
+# Time-to-solution benchmark. Runs each solver with seeds 1..n on #
+# each instance, checks every claimed solution with verify, and   #
+# writes per solver and instance the success probability, the     #
+# median, 90th and 99th percentile wall time to solution, and the  #
+# time to solution with 99% confidence, TTS99 = t*ln(0.01)/ln(1-p),#
+# where t is the mean wall time of a run and p the probability     #
+# that a run succeeds. Unsuccessful runs count as infinitely slow  #
+# in the percentiles. Usually run through make bench.              #
+#-----------------------------------------------------------------#
+
+usage() {
+  echo "Usage: bench.sh [-n seeds] [-t timeout] [-o results] [-b baseline] [-s solver]... filename.cnf..."
+  echo "  -n  seeds per solver and instance (default: 20)"
+  echo "  -t  seconds before a run is abandoned (default: 600)"
+  echo "  -o  tab-separated results file to write (default: bench.tsv)"
+  echo "  -b  earlier results file to compare TTS99 against"
+  echo "  -s  solver command, given -s seed and the instance (default: ./dmcsat"
+  echo "      and ./sweepsat); may be given more than once"
+  exit 1
+}
+
+seeds=20
+limit=600
+results=bench.tsv
+baseline=
+solvers=
+while getopts n:t:o:b:s: opt; do
+  case $opt in
+    n) seeds=$OPTARG;;
+    t) limit=$OPTARG;;
+    o) results=$OPTARG;;
+    b) baseline=$OPTARG;;
+    s) solvers="$solvers$OPTARG
+";;
+    *) usage;;
+  esac
+done
+shift $((OPTIND-1))
+[ $# -ge 1 ] || usage
+[ -n "$solvers" ] || solvers="./dmcsat
+./sweepsat
+"
+[ -x ./verify ] || { echo "verify is not built"; exit 1; }
+raw=$(mktemp)
+sol=$(mktemp)
+trap 'rm -f "$raw" "$sol"' EXIT
+
+#one line per run: solver, instance, seed, solved, wall seconds
+echo "$solvers" | while IFS= read -r solver; do
+  [ -n "$solver" ] || continue
+  for cnf in "$@"; do
+    seed=1
+    while [ $seed -le $seeds ]; do
+      beg=$(date +%s.%N)
+      out=$(timeout "$limit" $solver -s $seed "$cnf" 2>&1)
+      end=$(date +%s.%N)
+      solved=0
+      #the line after the first announcement of a solution holds its bits
+      echo "$out" | grep -i -A1 -m1 "found.*solution" | tail -n 1 > "$sol"
+      #a weighted instance has its best bits on a v line instead
+      [ -s "$sol" ] || echo "$out" | grep -m1 "^v " > "$sol"
+      if [ -s "$sol" ] && ./verify "$sol" "$cnf" | grep -q "^0 clauses violated"; then
+	solved=1
+      fi
+      printf "%s\t%s\t%d\t%d\t%s\n" "$solver" "$cnf" $seed $solved \
+	$(echo "$beg $end" | awk '{printf "%.6f", $2-$1}') >> "$raw"
+      seed=$((seed+1))
+    done
+  done
+done
+
+#summarize each solver and instance
+sort -t "$(printf '\t')" -k1,1 -k2,2 -k5,5g "$raw" | awk -F '\t' -v OFS='\t' '
+function flush() {
+  if(n == 0) return
+  p = solved/n
+  if(p == 0) tts = "inf"
+  else if(p >= 0.99) tts = sprintf("%.6f", total/n)
+  else tts = sprintf("%.6f", total/n*log(0.01)/log(1-p))
+  print key[1], key[2], n, solved+0, sprintf("%.4f", p), pct(0.5), pct(0.9), pct(0.99), sprintf("%.6f", total/n), tts
+  n = 0; solved = 0; total = 0; k = 0
+}
+#nearest-rank percentile of the times to solution, infinite if unsolved
+function pct(q,  r) {
+  r = int(q*n + 0.999999)
+  if(r < 1) r = 1
+  return r <= k ? t[r] : "inf"
+}
+BEGIN { print "solver", "instance", "runs", "solved", "p", "median", "p90", "p99", "mean", "tts99" }
+$1 != key[1] || $2 != key[2] { flush(); key[1] = $1; key[2] = $2 }
+{
+  n++; total += $5
+  if($4 == 1) { solved++; t[++k] = $5 }
+}
+END { flush() }' > "$results"
+
+column -t -s "$(printf '\t')" "$results" 2>/dev/null || cat "$results"
+echo "results written to $results"
+
+#compare TTS99 with the baseline, flagging anything 20% slower
+if [ -n "$baseline" ]; then
+  echo "TTS99 against $baseline:"
+  awk -F '\t' 'NR == FNR { if(FNR > 1) old[$1 "\t" $2] = $10; next }
+    FNR > 1 && ($1 "\t" $2) in old {
+      o = old[$1 "\t" $2]; m = $10
+      if(o == "inf" || m == "inf") r = (o == m) ? "same" : (m == "inf" ? "REGRESSED" : "improved")
+      else { x = m/o; r = sprintf("%.3fx%s", x, x > 1.2 ? " REGRESSED" : "") }
+      printf "%s\t%s\t%s -> %s\t%s\n", $1, $2, o, m, r
+    }' "$baseline" "$results"
+fi
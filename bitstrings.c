@@ -41,13 +41,13 @@ void flip(uint64_t *bs, int i, int B) {
 //copy a bit array from src to dest
 void copy_bits(uint64_t *src, uint64_t *dest, int B) {
   int i;
-  for(i = 0; i < 4; i++) dest[i] = src[i];
+  for(i = 0; i < WORDS(B); i++) dest[i] = src[i];
 }
 
 //allocate memory for bitstring and initialize bits to zero
 void init_bits(uint64_t *bs, int B) {
   int i;
-  for(i = 0; i < 4; i++) bs[i] = 0;
+  for(i = 0; i < WORDS(B); i++) bs[i] = 0;
 }
 
 
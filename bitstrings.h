@@ -3,6 +3,15 @@
 
 #include <stdint.h>
 
+//the number of 64-bit words needed to hold B bits
+#define WORDS(B) (((B)+63)>>6)
+
+//Bitstrings of up to DENSE_MAX bits are padded to 1, 2, 4 or 8 words
+//so that the dense kernels can be specialized on the width. This gives
+//that width, or 0 for longer bitstrings, which use the sparse kernels.
+#define DENSE_MAX 512
+#define DENSE_WORDS(B) ((B) <= 64 ? 1 : (B) <= 128 ? 2 : (B) <= 256 ? 4 : (B) <= DENSE_MAX ? 8 : 0)
+
 //extract the ith bit of bs
 int extract(uint64_t *bs, int i, int B);
 
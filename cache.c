@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bitstrings.h"
+#include "cache.h"
+
+static const char magic[8] = "dmcsat\n";
+
+//round n up to a multiple of a
+static size_t roundup(size_t n, size_t a) {
+  return (n+a-1)/a*a;
+}
+
+//the modification time of a file in nanoseconds
+static int64_t mtime(struct stat *st) {
+  return (int64_t)st->st_mtim.tv_sec*1000000000 + st->st_mtim.tv_nsec;
+}
+
+//Hash the contents of a file a word at a time. Returns 0 if it cannot
+//be read, which a cache will then never match.
+static uint64_t hashfile(char *filename) {
+  int fd;
+  struct stat st;
+  unsigned char *base;
+  uint64_t h, w;
+  size_t i;
+  fd = open(filename, O_RDONLY);
+  if(fd < 0) return 0;
+  if(fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return 0;
+  }
+  base = (unsigned char *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(base == MAP_FAILED) return 0;
+  madvise(base, st.st_size, MADV_SEQUENTIAL);
+  h = 14695981039346656037LLU ^ (uint64_t)st.st_size;
+  for(i = 0; i+8 <= (size_t)st.st_size; i += 8) {
+    memcpy(&w, base+i, 8);
+    h = (h^w)*0x9E3779B97F4A7C15LLU;
+    h ^= h>>32;
+  }
+  for(; i < (size_t)st.st_size; i++) h = (h^base[i])*1099511628211LLU;
+  munmap(base, st.st_size);
+  return h | 1;
+}
+
+//hash a string the same way, for instances generated from their names
+static uint64_t hashname(char *name) {
+  uint64_t h;
+  h = 14695981039346656037LLU;
+  for(; *name != 0; name++) h = (h^(unsigned char)*name)*1099511628211LLU;
+  return h | 1;
+}
+
+//identify the instance called name
+int identify(char *name, fileid *id) {
+  struct stat st;
+  if(stat(name, &st) != 0 || !S_ISREG(st.st_mode)) {
+    id->hash = hashname(name);
+    id->size = -1;
+    id->mtime = 0;
+    return 1;
+  }
+  id->size = st.st_size;
+  id->mtime = mtime(&st);
+  id->hash = hashfile(name);
+  return id->hash != 0;
+}
+
+//check that name is still the instance identified by id
+int same_instance(char *name, fileid *id) {
+  struct stat st;
+  if(stat(name, &st) != 0 || !S_ISREG(st.st_mode)) return id->size == -1 && id->hash == hashname(name);
+  if(id->size != (int64_t)st.st_size) return 0;
+  return id->mtime == mtime(&st) || id->hash == hashfile(name);
+}
+
+//Lay out the cache of an instance with total occurrences, and weights
+//if weighted is nonzero. The clauses and masks start on cache lines, as
+//they would from malloc.
+static void layout(cacheheader *hd, size_t total, int weighted) {
+  hd->clauses = roundup(sizeof(cacheheader), 64);
+  hd->lits = hd->clauses + (size_t)hd->numclauses*sizeof(clause);
+  hd->start = roundup(hd->lits + (size_t)hd->numlits*sizeof(literal), 8);
+  hd->occurs = hd->start + ((size_t)hd->B+1)*sizeof(int);
+  hd->masks = 0;
+  hd->weights = 0;
+  hd->size = hd->occurs + total*sizeof(occurrence);
+  if(weighted) {
+    hd->weights = roundup(hd->size, 8);
+    hd->size = hd->weights + (size_t)hd->numclauses*sizeof(weight);
+  }
+  if(hd->words > 0) {
+    hd->masks = roundup(hd->size, 64);
+    hd->size = hd->masks + (size_t)2*hd->words*hd->numclauses*sizeof(uint64_t);
+  }
+}
+
+//Map the cache of filename into sat if it matches the file, whose
+//status is st. Returns 0, quietly, if it does not.
+static int mapcache(char *filename, char *cachename, struct stat *st, instance *sat) {
+  int fd;
+  struct stat cst;
+  char *base;
+  cacheheader *hd;
+  cacheheader expect;
+  int *start;
+  fd = open(cachename, O_RDONLY);
+  if(fd < 0) return 0;
+  if(fstat(fd, &cst) != 0 || (size_t)cst.st_size < sizeof(cacheheader)) {
+    close(fd);
+    return 0;
+  }
+  base = (char *)mmap(NULL, cst.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(base == MAP_FAILED) return 0;
+  hd = (cacheheader *)base;
+  //a cache from another build or of another file, or a truncated one, is stale
+  expect = *hd;
+  if(memcmp(hd->magic, magic, 8) != 0 || hd->version != CACHE_VERSION || hd->clausesize != (int)sizeof(clause)
+     || hd->numclauses < 0 || hd->numlits < 0 || hd->B < 0 || hd->words != DENSE_WORDS(hd->B) || hd->size != (size_t)cst.st_size
+     || hd->cnfsize != (int64_t)st->st_size) {
+    munmap(base, cst.st_size);
+    return 0;
+  }
+  layout(&expect, 0, 0);
+  if(expect.clauses != hd->clauses || expect.lits != hd->lits || expect.start != hd->start || expect.occurs != hd->occurs || hd->occurs > hd->size) {
+    munmap(base, cst.st_size);
+    return 0;
+  }
+  start = (int *)(base + hd->start);
+  layout(&expect, start[hd->B] > 0 ? start[hd->B] : 0, hd->weights != 0);
+  if(start[0] != 0 || expect.weights != hd->weights || expect.masks != hd->masks || expect.size != hd->size) {
+    munmap(base, cst.st_size);
+    return 0;
+  }
+  //only rehash the file if it was touched since the cache was written
+  if(hd->mtime != mtime(st) && hd->hash != hashfile(filename)) {
+    munmap(base, cst.st_size);
+    return 0;
+  }
+  sat->numclauses = hd->numclauses;
+  sat->B = hd->B;
+  sat->words = hd->words;
+  sat->clauses = (clause *)(base + hd->clauses);
+  sat->lits = (literal *)(base + hd->lits);
+  sat->numlits = hd->numlits;
+  sat->masks = hd->masks > 0 ? (uint64_t *)(base + hd->masks) : NULL;
+  sat->start = start;
+  sat->occurs = (occurrence *)(base + hd->occurs);
+  sat->weights = hd->weights > 0 ? (weight *)(base + hd->weights) : NULL;
+  sat->hard = hd->hard;
+  sat->total = hd->total;
+  sat->mapping = base;
+  sat->mapsize = cst.st_size;
+  return 1;
+}
+
+//write n bytes of data at offset at of fd
+static int put(int fd, void *data, size_t n, size_t at) {
+  return n == 0 || pwrite(fd, data, n, at) == (ssize_t)n;
+}
+
+//Write the cache of sat, whose file had status st and contents hash.
+//It is written to a temporary file and renamed into place, so that
+//concurrent runs never see half a cache.
+static void savecache(char *cachename, struct stat *st, uint64_t hash, instance *sat) {
+  cacheheader hd;
+  char *tmpname;
+  int fd, ok;
+  memset(&hd, 0, sizeof(hd));
+  memcpy(hd.magic, magic, 8);
+  hd.version = CACHE_VERSION;
+  hd.clausesize = sizeof(clause);
+  hd.hash = hash;
+  hd.cnfsize = st->st_size;
+  hd.mtime = mtime(st);
+  hd.numclauses = sat->numclauses;
+  hd.B = sat->B;
+  hd.words = sat->words;
+  hd.numlits = sat->numlits;
+  hd.hard = sat->hard;
+  hd.total = sat->total;
+  layout(&hd, sat->start[sat->B], sat->weights != NULL);
+  tmpname = (char *)malloc(strlen(cachename)+32);
+  if(tmpname == NULL) return;
+  sprintf(tmpname, "%s.%i", cachename, (int)getpid());
+  fd = open(tmpname, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+  if(fd < 0) {
+    free(tmpname);
+    return;
+  }
+  ok = put(fd, &hd, sizeof(hd), 0);
+  ok = ok && put(fd, sat->clauses, (size_t)sat->numclauses*sizeof(clause), hd.clauses);
+  ok = ok && put(fd, sat->lits, (size_t)sat->numlits*sizeof(literal), hd.lits);
+  ok = ok && put(fd, sat->start, ((size_t)sat->B+1)*sizeof(int), hd.start);
+  ok = ok && put(fd, sat->occurs, (size_t)sat->start[sat->B]*sizeof(occurrence), hd.occurs);
+  if(ok && sat->weights != NULL)
+    ok = put(fd, sat->weights, (size_t)sat->numclauses*sizeof(weight), hd.weights);
+  if(ok && sat->words > 0)
+    ok = put(fd, sat->masks, (size_t)2*sat->words*sat->numclauses*sizeof(uint64_t), hd.masks);
+  ok = ok && ftruncate(fd, hd.size) == 0;
+  ok = (close(fd) == 0) && ok;
+  if(!ok || rename(tmpname, cachename) != 0) unlink(tmpname);
+  free(tmpname);
+}
+
+//load a DIMACS file through its cache
+int cachesat(char *filename, instance *sat) {
+  struct stat st;
+  char *cachename;
+  uint64_t hash;
+  if(stat(filename, &st) != 0 || !S_ISREG(st.st_mode)) return loadsat(filename, sat);
+  cachename = (char *)malloc(strlen(filename)+strlen(CACHE_SUFFIX)+1);
+  if(cachename == NULL) return loadsat(filename, sat);
+  sprintf(cachename, "%s%s", filename, CACHE_SUFFIX);
+  if(mapcache(filename, cachename, &st, sat)) {
+    free(cachename);
+    return 1;
+  }
+  //hash before parsing, so that a file changed in between leaves a stale cache rather than a wrong one
+  hash = hashfile(filename);
+  if(!loadsat(filename, sat)) {
+    free(cachename);
+    return 0;
+  }
+  savecache(cachename, &st, hash, sat);
+  free(cachename);
+  return 1;
+}
@@ -0,0 +1,68 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sat.h"
+
+//A compiled instance is cached next to its DIMACS file, in
+//filename.dmc, so that the thousands of short seeded runs made on one
+//instance only parse it once. The cache holds the clauses, occurrence
+//index, weights and dense masks exactly as they are laid out in memory, so
+//loading it is a single read-only mapping. The header records the
+//size, modification time and a hash of the contents of the DIMACS
+//file, and a cache that no longer matches its file, or was written by
+//a build with a different layout, is rebuilt.
+
+#define CACHE_SUFFIX ".dmc"
+
+//bump whenever the layout below or of the clauses changes
+#define CACHE_VERSION 4
+
+//the start of a cache file
+typedef struct {
+  char magic[8];       //"dmcsat\n" and a 0
+  int version;         //CACHE_VERSION
+  int clausesize;      //sizeof(clause) of the build that wrote it
+  uint64_t hash;       //hash of the contents of the DIMACS file
+  int64_t cnfsize;     //its size in bytes
+  int64_t mtime;       //and modification time, in nanoseconds
+  int numclauses;      //the instance
+  int B;
+  int words;
+  int numlits;
+  weight hard;         //the weight of a hard clause
+  weight total;        //and of all the clauses
+  size_t clauses;      //offset of the clauses
+  size_t lits;         //offset of their literals
+  size_t start;        //offset of the start of the occurrences of each variable
+  size_t occurs;       //offset of the occurrences
+  size_t weights;      //offset of the weights, 0 if unweighted
+  size_t masks;        //offset of the dense masks, 0 if sparse
+  size_t size;         //size of the whole file
+}cacheheader;
+
+//What identifies the instance called name, as opensat takes it: the
+//size, modification time and a hash of the contents of a DIMACS file,
+//or, for an instance generated from its name, a hash of the name with
+//a size of -1.
+typedef struct {
+  uint64_t hash;
+  int64_t size;
+  int64_t mtime;
+}fileid;
+
+//fill in the identity of the instance called name; returns 0 if a file cannot be read
+int identify(char *name, fileid *id);
+
+//Whether name is still the instance identified by id. As for a cache,
+//the file is only hashed again if it was touched since.
+int same_instance(char *name, fileid *id);
+
+//Load the DIMACS file filename as loadsat does, through its cache:
+//map the cache if it matches the file, and otherwise load the file and
+//write the cache for next time. Failing to write the cache, say in a
+//read-only directory, is not an error. Returns 0 on failure.
+int cachesat(char *filename, instance *sat);
+
+#endif
@@ -19,145 +19,398 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <math.h>
+#include <unistd.h>
 #include "bitstrings.h"
 #include "sat.h"
 #include "walk.h"
+#include "sample.h"
+#include "share.h"
+#include "kinetic.h"
+#include "schedule.h"
+#include "profile.h"
+#include "generate.h"
+#include "telemetry.h"
+#include "preprocess.h"
+#include "polish.h"
 
 double vscale; //the scaling of the potential
 
-//W is the number of walkers, duration is the physical time, and 
-//instance a structure containing the SAT instance.
-void walk(int W, double duration, instance *sat) {
-  walker *walkers1;
-  walker *walkers2;
-  walker *cur;          //the current locations of walkers
-  walker *pro;          //the locations in progress
-  walker *tmp;          //temporary holder for pointer swapping
+//W is the number of walkers, sc the annealing schedule, started at
+//the duration of this run, and instance a structure containing the SAT
+//instance. If incremental is nonzero the walkers cache their clause
+//counts and flip deltas. In run number run, walker w draws all of its
+//random numbers from stream (run<<32)+w of seed. If sh is not NULL, the
+//population trades walkers with the elite ring of the shared segment
+//every interval timesteps. The best walker seen goes into rec. If pre
+//is not NULL, sat is the simplified instance and solutions are printed
+//as bitstrings of the original. If pol is not NULL, a walker at or
+//below its level is polished when the polisher's schedule allows, and
+//a solution it reaches ends the run. Returns the number of solutions found.
+int walk(int W, schedule *sc, instance *sat, int incremental, uint64_t seed, int run,
+	 shared *sh, int interval, record *rec, preprocessor *pre, polisher *pol) {
+  population pop;
+  population *cur;      //the locations of walkers, updated in place
+  staging st;           //copies of teleport sources about to be overwritten
   int w;                //w indexes walker
+  int i;                //indexes the action lists
   double s;             //current value of s
   double phop;          //probability of hopping to a neighboring vertex
-  double ptel;          //probability of teleporting to another walker's location
-  int action;           //0 = hop, 1 = teleport, 2 = sit
+  double ptel;          //probability of teleporting per unit of potential above umin
+  actions act;          //the walkers that hop, teleport and sit this timestep
+  rng *streams;         //the random number stream of each walker
   clock_t beg, end;     //for code timing
   double time_spent;    //for code timing
-  int umin, umax;       //the min&max number of unsatisfied clauses amongst occupied locations
+  weight umin, umax;    //the min&max weight of unsatisfied clauses amongst occupied locations
   int winners;          //number of times a walker hits zero potential
   int sitters;          //number of times a walker sits in place
   int teleporters;      //number of times a walker teleports
   int hoppers;          //number of times a walker hops
   double dt;            //the adjustable timestep
-  double time;          //the total time evolution elapsed
   double last_output;   //the time elapsed at the last screen output
   int steps;            //steps since last screen output
+  int stepcount;        //steps in all
+  rng elites;           //stream for trading with the elite ring
+  rng polishing;        //stream for the local search
+  int polished;         //whether the local search found the solution
+  uint64_t base;        //the first stream of this run
   beg = clock();
-  walkers1 = (walker *)malloc(W*sizeof(walker));
-  walkers2 = (walker *)malloc(W*sizeof(walker));
-  if(walkers1 == NULL || walkers2 == NULL) {
+  streams = (rng *)malloc(W*sizeof(rng));
+  if(!alloc_population(&pop, W, sat, incremental) || streams == NULL || !alloc_actions(&act, W)
+     || !alloc_staging(&st, &pop, sat)) {
     printf("Unable to allocate memory for walkers.\n");
-    return;
-  }
-  for(w = 0; w < W; w++) {
-    init_bits(walkers1[w].bs, sat->B);
-    init_bits(walkers2[w].bs, sat->B);
+    return 0;
   }
   //initialize the walkers to the uniform distribution
-  cur = walkers1;
-  pro = walkers2;
-  randomize(cur, W, sat);
+  cur = &pop;
+  base = (uint64_t)run<<32;
+  for(w = 0; w < W; w++) rng_seed(&streams[w], seed, base+w);
+  rng_seed(&elites, seed, base+W);
+  if(pol != NULL) restart_polisher(pol);
+  rng_seed(&polishing, seed, base+W+2);
+  randomize(cur, sat, streams);
+  population_stats(cur);
+  update_record(rec, cur, sat);
   //do the time evolution
   winners = 0;
+  polished = 0;
   teleporters = 0;
   hoppers = 0;
   sitters = 0;
-  time = 0;
   last_output = 0;
   steps = 0;
+  stepcount = 0;
   do {
-    s = time/duration;
-    //calculate the minimum potential amongst currently occupied locations
-    umin = cur[0].unsat;
-    umax = umin;
-    for(w = 0; w < W; w++) {
-      if(cur[w].unsat < umin) umin = cur[w].unsat;
-      if(cur[w].unsat > umax) umax = cur[w].unsat;
-    }
+    s = schedule_s(sc);
+    //the minimum potential amongst currently occupied locations
+    //was computed along with the maximum at the end of the last step
+    umin = cur->umin;
+    umax = cur->umax;
     dt = 0.99/(1.0-s+s*vscale*(double)(umax-umin)); //this ensures we have no negative probabilities
-    for(w = 0; w < W; w++) {
-      phop = (1.0-s)*dt;
-      //subtracting umin yields invariance under uniform potential change
-      ptel = dt*s*vscale*(double)(cur[w].unsat-umin); //here we subtract the offset
-      action = tern(phop, ptel);
-      if(action == 2) {
-        sit(&cur[w], &pro[w], sat->B);
-        sitters++;
-      }
-      if(action == 1) {
-        teleport(cur, pro, w, W, sat->B);
-        teleporters++;
-      }
-      if(action == 0) {
-        hop(&cur[w], &pro[w], sat);
-        hoppers++;
-      }
+    phop = (1.0-s)*dt;
+    //subtracting umin yields invariance under uniform potential change
+    ptel = dt*s*vscale; //multiplied by cur->unsat[w]-umin in the sampler
+    TALLY(steps, 1);
+    TALLY_DT(dt);
+    sample_actions(&act, cur, umin, phop, ptel, streams);
+    //the teleports go first, since they read where the hoppers started
+    if(!teleport_inplace(cur, &act, &st, sat, streams)) {
+      printf("Unable to allocate memory for teleports.\n");
+      break;
     }
-    //swap pro with cur
-    tmp = pro;
-    pro = cur;
-    cur = tmp;
+    for(i = 0; i < act.nhop; i++) {
+      w = act.hops[i];
+      hop_inplace(cur, w, sat, &streams[w]);
+    }
+    //the sitters stay where they are
+    teleporters += act.ntel;
+    hoppers += act.nhop;
+    sitters += act.nsit;
     steps++;
-    if(time == 0 || time - last_output >= duration/100.0) { //periodically output some statistics:
-      printf("sitters: %e\thoppers: %e\tteleporters: %e\tviolated = %i\n", 
-	     (double)sitters/(double)(W*steps), (double)hoppers/(double)(W*steps), (double)teleporters/(double)(W*steps), umin);
+    if(sc->time == 0 || sc->time - last_output >= sc->duration/100.0) { //periodically output some statistics:
+      printf("sitters: %e\thoppers: %e\tteleporters: %e\tviolated = %lli\n", 
+	     (double)sitters/(double)(W*steps), (double)hoppers/(double)(W*steps), (double)teleporters/(double)(W*steps), (long long)umin);
+      telemetry_sample(run, sc->time, s, dt, umin, umax);
       sitters = 0;
       teleporters = 0;
       hoppers = 0;
-      last_output = time;
+      last_output = sc->time;
       steps = 0;
     }
-    for(w = 0; w < W; w++) if(cur[w].unsat == 0) winners++;
-    time += dt;
-  }while(time < duration && winners == 0);
-  if(winners > 0) {
+    //one pass gives the winners and next step's umin and umax
+    population_stats(cur);
+    stepcount++;
+    if(sh != NULL && stepcount%interval == 0) {
+      share_elites(sh, cur, sat, &elites);
+      population_stats(cur);
+    }
+    update_record(rec, cur, sat);
+    winners = cur->zeros;
+    if(winners == 0 && pol != NULL && polish_population(pol, cur, sat, rec, &polishing)) {
+      polished = 1;
+      winners = 1;
+    }
+    advance_schedule(sc, dt, umax-umin);
+  }while(!schedule_done(sc) && winners == 0);
+  if(polished) {
+    printf("Found 1 solution by polishing:\n");
+    print_original(pre, pol->bs, sat->B);
+    offer_record(rec, pol->bs, 0, sat);
+  }
+  else if(winners > 0) {
     if(winners == 1) printf("Found 1 solution:\n");
     else printf("Found %i solutions:\n", winners);
-    for(w = 0; w < W; w++) if(cur[w].unsat == 0) print_bits(cur[w].bs, sat->B);
+    for(w = 0; w < W; w++) if(cur->unsat[w] == 0) print_original(pre, cur->walkers[w].bs, sat->B);
+  }
+  end = clock();
+  free_population(&pop);
+  free_staging(&st);
+  free_actions(&act);
+  free(streams);
+  if(pol != NULL) printf("polished %ld walkers with %ld flips\n", pol->polishes, pol->flipped);
+  time_spent = (double)(end - beg)/CLOCKS_PER_SEC;
+  printf("runtime: %f seconds\n", time_spent);
+  return winners;
+}
+
+//The event-driven version of walk, with the same arguments except
+//that only the duration of the schedule is used, since the rates are
+//only linear in time for the linear schedule. Rather than taking
+//timesteps, it draws the time of every hop and teleport directly, and
+//looks at the population after each unit of physical time. In this
+//mode interval counts units of time, and so does the gap between
+//polishes.
+int walk_events(int W, schedule *sc, instance *sat, int incremental, uint64_t seed, int run,
+		shared *sh, int interval, record *rec, preprocessor *pre, polisher *pol) {
+  population pop;
+  kinetic k;            //the event-driven process
+  int w;                //w indexes walker
+  rng *streams;         //the random number stream of each walker
+  rng elites;           //stream for trading with the elite ring
+  rng polishing;        //stream for the local search
+  int polished;         //whether the local search found the solution
+  clock_t beg, end;     //for code timing
+  double time_spent;    //for code timing
+  int units;            //units of time in all
+  long hops;            //hops at the last screen output
+  long teleports;       //teleports at the last screen output
+  double last_output;   //the time elapsed at the last screen output
+  double duration;      //the duration of this run
+  uint64_t base;        //the first stream of this run
+  int winners;
+  beg = clock();
+  duration = sc->duration;
+  streams = (rng *)malloc(W*sizeof(rng));
+  if(!alloc_population(&pop, W, sat, incremental) || streams == NULL) {
+    printf("Unable to allocate memory for walkers.\n");
+    return 0;
   }
+  //initialize the walkers to the uniform distribution
+  base = (uint64_t)run<<32;
+  for(w = 0; w < W; w++) rng_seed(&streams[w], seed, base+w);
+  rng_seed(&elites, seed, base+W);
+  if(pol != NULL) restart_polisher(pol);
+  rng_seed(&polishing, seed, base+W+2);
+  randomize(&pop, sat, streams);
+  population_stats(&pop);
+  update_record(rec, &pop, sat);
+  kinetic_init(&k, duration, vscale, seed, base+W+1);
+  units = 0;
+  hops = 0;
+  teleports = 0;
+  last_output = 0;
+  polished = 0;
+  while(k.time < duration && pop.zeros == 0 && !polished) {
+    kinetic_run(&k, &pop, sat, k.time+1.0, streams);
+    units++;
+    TALLY(steps, 1);
+    if(units == 1 || k.time - last_output >= duration/100.0) { //periodically output some statistics:
+      printf("hops: %e\tteleports: %e\tviolated = %lli\n", (double)(k.hops-hops)/(W*(k.time-last_output)),
+	     (double)(k.teleports-teleports)/(W*(k.time-last_output)), (long long)pop.umin);
+      telemetry_sample(run, k.time, k.time/duration, 0, pop.umin, pop.umax);
+      hops = k.hops;
+      teleports = k.teleports;
+      last_output = k.time;
+    }
+    if(sh != NULL && units%interval == 0) {
+      share_elites(sh, &pop, sat, &elites);
+      population_stats(&pop);
+    }
+    update_record(rec, &pop, sat);
+    if(pop.zeros == 0 && pol != NULL) polished = polish_population(pol, &pop, sat, rec, &polishing);
+  }
+  if(polished) {
+    printf("Found 1 solution by polishing:\n");
+    print_original(pre, pol->bs, sat->B);
+    offer_record(rec, pol->bs, 0, sat);
+  }
+  else if(pop.zeros > 0) {
+    if(pop.zeros == 1) printf("Found 1 solution:\n");
+    else printf("Found %i solutions:\n", pop.zeros);
+    for(w = 0; w < W; w++) if(pop.unsat[w] == 0) print_original(pre, pop.walkers[w].bs, sat->B);
+  }
+  printf("events: %ld hops, %ld teleports\n", k.hops, k.teleports);
+  winners = polished ? 1 : pop.zeros;
   end = clock();
-  free(walkers1);
-  free(walkers2);
+  free_population(&pop);
+  free(streams);
+  if(pol != NULL) printf("polished %ld walkers with %ld flips\n", pol->polishes, pol->flipped);
   time_spent = (double)(end - beg)/CLOCKS_PER_SEC;
   printf("runtime: %f seconds\n", time_spent);
+  return winners;
+}
+
+//print the command line options
+void usage() {
+  printf("Usage: dmcsat [-e] [-i] [-P] [-l level] [-f flips] [-g gap] [-s seed] [-d duration] [-a schedule] [-r restarts] [-n runs]\n");
+  printf("              [-p profile] [-T telemetry] [-m name] [-k interval] filename.cnf\n");
+  printf("  -e  draw the time of each event instead of taking timesteps\n");
+  printf("      (linear schedule only)\n");
+  printf("  -i  cache clause counts and flip deltas in each walker\n");
+  printf("  -P  simplify the instance before walking (not with -m)\n");
+  printf("  -l  polish a walker with at most this many violated clauses (or\n");
+  printf("      this weight) by local search as it is reached\n");
+  printf("  -f  flips of each polish (default: 4 per bit)\n");
+  printf("  -g  timesteps between polishes while the lowest energy in the\n");
+  printf("      population does not improve (default: 100)\n");
+  printf("  -s  seed for the random number streams (default: the time)\n");
+  printf("  -d  base duration of a run (default: tuned for random 3SAT)\n");
+  printf("  -a  annealing schedule: linear (default), power:p,\n");
+  printf("      piecewise:u/s,u/s,... or adaptive:k\n");
+  printf("  -r  restart policy: fixed (default), luby or geometric:g\n");
+  printf("  -n  most runs to make before giving up (default: 1)\n");
+  printf("  -p  take the parameters from the nearest teleport entry of a\n");
+  printf("      profile written by tunesat\n");
+  printf("  -T  write the telemetry counters to a .json or .csv file\n");
+  printf("  -m  share the instance and elite walkers with other processes\n");
+  printf("      through the POSIX shared memory segment name, e.g. /dmc\n");
+  printf("  -k  timesteps (units of time with -e) between trades with the\n");
+  printf("      elite ring (default: 100)\n");
 }
 
 //load a SAT instance and try to solve it using our Monte Carlo process
 int main(int argc, char *argv[]) {
   int W;             //number of walkers
   unsigned int seed; //seed for rng
-  double duration;   //the duration of 
+  double duration;   //the base duration of a run
+  int run;           //the run under way
+  int runs;          //the most runs to make
+  schedule sc;       //the annealing schedule
+  restarts rs;       //the restart policy
+  char *anneal;      //the description of the schedule
+  char *policy;      //the description of the restart policy
+  char *profile;     //the parameter profile, or NULL
+  double tuned;      //the duration it gives
+  char *telemetry;   //the telemetry file, or NULL
   instance sat;      //the SAT instance
   int success;       //to flag successful loading of the SAT instance from the input
-  if(argc != 2) {
-    printf("Usage: loadsat filename.cnf\n");
+  int incremental;   //whether to use the incremental hop
+  int events;        //whether to use the event-driven process
+  int opt;           //for parsing the command line
+  shared sh;         //the shared memory segment
+  char *name;        //its name, or NULL
+  int interval;      //timesteps between trades with it
+  record best;       //the best walker of all the runs
+  int simplify;      //whether to preprocess the instance
+  preprocessor pre;  //how to undo that
+  weight level;      //the unsat at which walkers are polished, -1 for none
+  int flips;         //flips of each polish
+  int gap;           //timesteps between polishes unless the minimum improves
+  polisher pol;      //the local search
+  level = -1;
+  flips = 0;
+  gap = 0;
+  simplify = 0;
+  incremental = 0;
+  events = 0;
+  name = NULL;
+  interval = 100;
+  duration = 0;
+  runs = 1;
+  anneal = "linear";
+  policy = "fixed";
+  profile = NULL;
+  telemetry = NULL;
+  seed = time(NULL); //choose rng seed
+  while((opt = getopt(argc, argv, "eiPl:f:g:s:d:a:r:n:p:T:m:k:")) != -1) {
+    if(opt == 'e') events = 1;
+    else if(opt == 'l') level = atoll(optarg);
+    else if(opt == 'f') flips = atoi(optarg);
+    else if(opt == 'g') gap = atoi(optarg);
+    else if(opt == 'P') simplify = 1;
+    else if(opt == 'i') incremental = 1;
+    else if(opt == 's') seed = strtoul(optarg, NULL, 10);
+    else if(opt == 'd') duration = atof(optarg);
+    else if(opt == 'a') anneal = optarg;
+    else if(opt == 'r') policy = optarg;
+    else if(opt == 'n') runs = atoi(optarg);
+    else if(opt == 'p') profile = optarg;
+    else if(opt == 'T') telemetry = optarg;
+    else if(opt == 'm') name = optarg;
+    else if(opt == 'k') interval = atoi(optarg);
+    else {
+      usage();
+      return 0;
+    }
+  }
+  if(optind != argc-1 || interval < 1 || runs < 1 || duration < 0
+     || !parse_schedule(&sc, anneal) || !parse_restarts(&rs, policy)
+     || (events && (sc.shape != SHAPE_LINEAR || sc.slowdown > 0)) || (simplify && name != NULL) || flips < 0 || gap < 0 || (level < 0 && (flips > 0 || gap > 0))) {
+    usage();
     return 0;
   }
-  success = loadsat(argv[1], &sat);
+  if(name != NULL) success = attach_shared(&sh, name, argv[optind], &sat);
+  else success = opensat(argv[optind], &sat);
   if(!success) return 0;
   //otherwise:
   printf("%i clauses, %i variables\n", sat.numclauses, sat.B);
-  seed = time(NULL); //choose rng seed
-  //seed = 1;        //for testing
-  srand(seed);       //initialize rng
-  //The following tuned parameters were obtained by trial and error.
-  //They are tuned for random 3SAT at the sat/unsat phase transition.
-  W = 100;
-  vscale = 75.0/(double)sat.B;
-  duration = 188.0*exp(0.053*(double)sat.B);
-  printf("seed = %d\n", seed); //for reproducibility
+  if(sat.weights != NULL) printf("weighted, hard clauses of weight %lli\n", (long long)sat.hard);
+  if(simplify) {
+    if(!preprocess(&sat, &pre)) return 0;
+    if(pre.active && sat.numclauses == 0) {
+      printf("Found 1 solution:\n");
+      print_original(&pre, NULL, 0);
+      free_preprocessor(&pre);
+      freesat(&sat);
+      return 0;
+    }
+  }
+  //the defaults are tuned for random 3SAT at the sat/unsat phase transition
+  if(!load_profile(profile, 0, &sat, &W, &vscale, &tuned)) return 0;
+  if(duration == 0) duration = tuned;
+  printf("seed = %u\n", seed); //for reproducibility
   printf("bits = %i\n", sat.B);
   printf("walkers = %i\n", W);
   printf("duration = %e\n", duration);
   printf("vscale = %e\n", vscale);
-  walk(W, duration, &sat);
-  freesat(&sat);
+  if(incremental) printf("incremental hops\n");
+  if(name != NULL) printf("sharing through %s every %i steps\n", name, interval);
+  if(events) printf("event-driven\n");
+  if(level >= 0) {
+    if(flips == 0) flips = 4*sat.B;
+    if(gap == 0) gap = 100;
+    printf("polishing at %lli with %i flips every %i steps\n", (long long)level, flips, gap);
+  }
+  printf("schedule = %s\n", anneal);
+  printf("restarts = %s\n", policy);
+  if(telemetry != NULL && !telemetry_open(telemetry)) return 0;
+  if(!alloc_record(&best, &sat) || (level >= 0 && !alloc_polisher(&pol, &sat, level, flips, gap))) {
+    printf("Unable to allocate memory for walkers.\n");
+    return 0;
+  }
+  //restart until some run finds a solution
+  for(run = 0; run < runs; run++) {
+    start_schedule(&sc, restart_duration(&rs, run, duration));
+    if(runs > 1) printf("run %i: duration = %e\n", run, sc.duration);
+    if(events) success = walk_events(W, &sc, &sat, incremental, seed, run, name != NULL ? &sh : NULL, interval, &best, simplify ? &pre : NULL, level >= 0 ? &pol : NULL);
+    else success = walk(W, &sc, &sat, incremental, seed, run, name != NULL ? &sh : NULL, interval, &best, simplify ? &pre : NULL, level >= 0 ? &pol : NULL);
+    if(success > 0) break;
+  }
+  if(sat.weights != NULL) print_maxsat(&sat, best.bs, best.unsat);
+  free_record(&best);
+  if(simplify) free_preprocessor(&pre);
+  if(level >= 0) free_polisher(&pol);
+  telemetry_close();
+  if(name != NULL) detach_shared(&sh);
+  else freesat(&sat);
   return 0;
 }
@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "bitstrings.h"
+#include "generate.h"
+#include "cache.h"
+
+//Allocate the clauses of an instance with B bits and round(ratio*B)
+//clauses of length k. Returns 0 if the sizes are out of range.
+static int alloc_clauses(instance *sat, int B, double ratio, int k) {
+  int i;
+  if(k < 1 || B < k || ratio <= 0) {
+    printf("Cannot generate %i-SAT on %i variables at ratio %f.\n", k, B, ratio);
+    return 0;
+  }
+  sat->B = B;
+  sat->weights = NULL;
+  sat->numclauses = (int)round(ratio*(double)B);
+  sat->numlits = sat->numclauses*k;
+  sat->clauses = (clause *)malloc((sat->numclauses > 0 ? sat->numclauses : 1)*sizeof(clause));
+  sat->lits = (literal *)malloc((sat->numlits > 0 ? sat->numlits : 1)*sizeof(literal));
+  if(sat->clauses == NULL || sat->lits == NULL) {
+    printf("Memory allocation error in alloc_clauses.\n");
+    free(sat->clauses);
+    free(sat->lits);
+    return 0;
+  }
+  for(i = 0; i < sat->numclauses; i++) {
+    sat->clauses[i].first = i*k;
+    sat->clauses[i].numvars = k;
+  }
+  return 1;
+}
+
+//draw k distinct variables with uniformly random signs into l
+static void draw_clause(literal *l, int B, int k, rng *r) {
+  int j, i, v;
+  for(j = 0; j < k; j++) {
+    do {
+      v = randint(r, B);
+      for(i = 0; i < j && LITVAR(l[i]) != v; i++);
+    }while(i < j);
+    l[j] = LIT(v, (int)(rng_next(r)>>63));
+  }
+}
+
+//fill in a uniform random instance
+int randomsat(instance *sat, int B, double ratio, int k, rng *r) {
+  int i;
+  if(!alloc_clauses(sat, B, ratio, k)) return 0;
+  for(i = 0; i < sat->numclauses; i++) draw_clause(sat->lits + (size_t)i*k, B, k, r);
+  return compilesat(sat);
+}
+
+//fill in a planted instance
+int plantsat(instance *sat, int B, double ratio, int k, uint64_t *solution, rng *r) {
+  int i, j;
+  literal *l;
+  if(!alloc_clauses(sat, B, ratio, k)) return 0;
+  for(i = 0; i < WORDS(B); i++) solution[i] = rng_next(r);
+  //keep the padding above bit B clear, as in every other bitstring
+  if(B&63) solution[WORDS(B)-1] &= (1LLU<<(B&63))-1;
+  for(i = 0; i < sat->numclauses; i++) {
+    l = sat->lits + (size_t)i*k;
+    draw_clause(l, B, k, r);
+    //redraw the signs of a clause the hidden assignment violates
+    while(violated(solution, sat, i))
+      for(j = 0; j < k; j++) l[j] = LIT(LITVAR(l[j]), (int)(rng_next(r)>>63));
+  }
+  return compilesat(sat);
+}
+
+//write the instance in DIMACS cnf format
+int writesat(char *filename, instance *sat, char *comment) {
+  FILE *fp;
+  int i, j;
+  literal l;
+  fp = fopen(filename, "w");
+  if(fp == NULL) {
+    printf("Error: unable to write %s\n", filename);
+    return 0;
+  }
+  if(comment != NULL) fprintf(fp, "c %s\n", comment);
+  fprintf(fp, "p cnf %i %i\n", sat->B, sat->numclauses);
+  for(i = 0; i < sat->numclauses; i++) {
+    for(j = 0; j < sat->clauses[i].numvars; j++) {
+      l = sat->lits[sat->clauses[i].first+j];
+      fprintf(fp, "%i ", LITNOT(l) ? -(LITVAR(l)+1) : LITVAR(l)+1);
+    }
+    fprintf(fp, "0\n");
+  }
+  return fclose(fp) == 0;
+}
+
+//load a DIMACS file or generate an instance in memory
+int opensat(char *name, instance *sat) {
+  uint64_t *solution;
+  unsigned long seed;
+  double ratio;
+  int B, k, ok;
+  char end;
+  rng r;
+  if(strncmp(name, "random:", 7) != 0 && strncmp(name, "planted:", 8) != 0) return cachesat(name, sat);
+  if(sscanf(strchr(name, ':')+1, "%i,%lf,%i,%lu%c", &B, &ratio, &k, &seed, &end) != 4) {
+    printf("Error: %s should be random:B,ratio,k,seed or planted:B,ratio,k,seed\n", name);
+    return 0;
+  }
+  rng_seed(&r, seed, 0);
+  if(name[0] == 'r') return randomsat(sat, B, ratio, k, &r);
+  solution = (uint64_t *)malloc(WORDS(B > 0 ? B : 1)*sizeof(uint64_t));
+  if(solution == NULL) {
+    printf("Memory allocation error in opensat.\n");
+    return 0;
+  }
+  ok = plantsat(sat, B, ratio, k, solution, &r);
+  free(solution);
+  return ok;
+}
@@ -0,0 +1,34 @@
+#ifndef GENERATE_H
+#define GENERATE_H
+
+#include <stdint.h>
+#include "sat.h"
+#include "rng.h"
+
+//Random instances, so that benchmarks and tuning do not depend on
+//downloading SATLIB. A uniform random k-SAT instance has round(ratio*B)
+//clauses, each on k distinct variables chosen uniformly with uniformly
+//random signs. A planted instance is the same, except that clauses
+//violated by a hidden assignment are redrawn, so the hidden assignment
+//is guaranteed to satisfy it. Either can be written out in DIMACS
+//format or handed to a solver in memory through opensat.
+
+//Fill in a uniform random k-SAT instance, compiled as by loadsat.
+//Returns 0 on failure.
+int randomsat(instance *sat, int B, double ratio, int k, rng *r);
+
+//Fill in a planted k-SAT instance, and its hidden satisfying assignment
+//in solution, which must hold WORDS(B) words. Returns 0 on failure.
+int plantsat(instance *sat, int B, double ratio, int k, uint64_t *solution, rng *r);
+
+//write the instance to filename in DIMACS cnf format, with a comment
+int writesat(char *filename, instance *sat, char *comment);
+
+//Load the instance called name. This is either a DIMACS file, loaded
+//through its cache (see cache.h), or random:B,ratio,k,seed or
+//planted:B,ratio,k,seed, which generates the instance in memory from
+//stream 0 of seed, exactly as gensat -s seed would write it. Returns 0
+//on failure.
+int opensat(char *name, instance *sat);
+
+#endif
@@ -0,0 +1,111 @@
+/*-----------------------------------------------------------------
+  This program writes random k-SAT instances in DIMACS cnf format,
+  for benchmarking and tuning on machines that cannot download
+  SATLIB. Uniform random instances at the sat/unsat transition
+  (ratio 4.26 for 3SAT) are satisfiable about half the time;
+  planted instances are always satisfiable, and their hidden
+  solution is written alongside them in the format verify reads.
+  The solvers can also generate the same instances in memory, see
+  opensat in generate.h.
+  -----------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <malloc.h> //omit on mac
+#include <time.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "bitstrings.h"
+#include "sat.h"
+#include "generate.h"
+
+//write a bitstring to filename as a line of zeros and ones
+int writebits(char *filename, uint64_t *bs, int B) {
+  FILE *fp;
+  int i;
+  fp = fopen(filename, "w");
+  if(fp == NULL) {
+    printf("Error: unable to write %s\n", filename);
+    return 0;
+  }
+  for(i = 0; i < B; i++) fputc('0'+extract(bs, i, B), fp);
+  fputc('\n', fp);
+  return fclose(fp) == 0;
+}
+
+//print the command line options
+void usage() {
+  printf("Usage: gensat [-p] [-k k] [-r ratio] [-s seed] [-c count] [-o prefix] B\n");
+  printf("  -p  plant a solution, which is written to prefix-i.sol\n");
+  printf("  -k  variables per clause (default: 3)\n");
+  printf("  -r  clauses per variable (default: 4.26)\n");
+  printf("  -s  seed; instance i is generated from seed+i, so that it equals\n");
+  printf("      random:B,ratio,k,seed+i or planted:B,ratio,k,seed+i given to a\n");
+  printf("      solver in place of a file (default: the time)\n");
+  printf("  -c  number of instances (default: 1)\n");
+  printf("  -o  the instances are written to prefix-i.cnf (default: uf<B> or pl<B>)\n");
+}
+
+int main(int argc, char *argv[]) {
+  instance sat;        //the instance
+  uint64_t *solution;  //its hidden solution, if planted
+  int planted;         //whether to plant a solution
+  int k;               //variables per clause
+  double ratio;        //clauses per variable
+  unsigned int seed;   //seed for rng
+  int count;           //number of instances
+  char *prefix;        //prefix of the file names
+  char deflt[32];      //the default prefix
+  char filename[4096];
+  char comment[256];
+  int B, i, opt, ok;
+  rng r;
+  planted = 0;
+  k = 3;
+  ratio = 4.26;
+  seed = time(NULL);
+  count = 1;
+  prefix = NULL;
+  while((opt = getopt(argc, argv, "pk:r:s:c:o:")) != -1) {
+    if(opt == 'p') planted = 1;
+    else if(opt == 'k') k = atoi(optarg);
+    else if(opt == 'r') ratio = atof(optarg);
+    else if(opt == 's') seed = strtoul(optarg, NULL, 10);
+    else if(opt == 'c') count = atoi(optarg);
+    else if(opt == 'o') prefix = optarg;
+    else {
+      usage();
+      return 0;
+    }
+  }
+  if(optind != argc-1 || count < 1 || (B = atoi(argv[optind])) < 1) {
+    usage();
+    return 0;
+  }
+  if(prefix == NULL) {
+    sprintf(deflt, "%s%i", planted ? "pl" : "uf", B);
+    prefix = deflt;
+  }
+  solution = (uint64_t *)malloc(WORDS(B)*sizeof(uint64_t));
+  if(solution == NULL) {
+    printf("Unable to allocate memory for the solution.\n");
+    return 0;
+  }
+  for(i = 0; i < count; i++) {
+    rng_seed(&r, seed+i, 0);
+    if(planted) ok = plantsat(&sat, B, ratio, k, solution, &r);
+    else ok = randomsat(&sat, B, ratio, k, &r);
+    if(!ok) return 0;
+    sprintf(comment, "%s:%i,%g,%i,%u", planted ? "planted" : "random", B, ratio, k, seed+i);
+    snprintf(filename, sizeof(filename), "%s-%i.cnf", prefix, i);
+    if(!writesat(filename, &sat, comment)) return 0;
+    if(planted) {
+      snprintf(filename, sizeof(filename), "%s-%i.sol", prefix, i);
+      if(!writebits(filename, solution, B)) return 0;
+    }
+    freesat(&sat);
+  }
+  printf("%i instances written to %s-*.cnf\n", count, prefix);
+  free(solution);
+  return 0;
+}
@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "bitstrings.h"
+#include "island.h"
+#include "walk.h"
+
+//allocate the mailboxes of I islands
+int alloc_archipelago(archipelago *a, int I, int interval, int size, instance *sat) {
+  int i;
+  a->stride = DENSE_WORDS(sat->B);
+  if(a->stride == 0) a->stride = WORDS(sat->B);
+  a->I = I;
+  a->interval = interval;
+  a->size = size;
+  a->boxes = (mailbox *)malloc(I*sizeof(mailbox));
+  if(a->boxes == NULL) return 0;
+  for(i = 0; i < I; i++) {
+    atomic_init(&a->boxes[i].full, 0);
+    a->boxes[i].n = 0;
+    a->boxes[i].bits = (uint64_t *)calloc((size_t)size*a->stride, sizeof(uint64_t));
+    a->boxes[i].slots = (int *)malloc(size*sizeof(int));
+    if(a->boxes[i].bits == NULL || a->boxes[i].slots == NULL) return 0;
+  }
+  return 1;
+}
+
+//free the memory allocated by alloc_archipelago
+void free_archipelago(archipelago *a) {
+  int i;
+  for(i = 0; i < a->I; i++) {
+    free(a->boxes[i].bits);
+    free(a->boxes[i].slots);
+  }
+  free(a->boxes);
+}
+
+//the lowest level at or above which there are at least n walkers
+static weight top_level(population *pop, int n) {
+  return population_rank(pop, pop->W-n+1);
+}
+
+//the highest level at or below which there are at least n walkers
+static weight bottom_level(population *pop, int n) {
+  return population_rank(pop, n);
+}
+
+//exchange walkers with the neighboring islands
+void migrate(archipelago *a, int i, population *pop, instance *sat) {
+  mailbox *out, *in;
+  int n, k, w;
+  weight cut;
+  if(a->I < 2) return;
+  n = a->size;
+  if(n > pop->W) n = pop->W;
+  //the best walkers: all of those below the cut and enough at it
+  out = &(a->boxes[(i+1)%a->I]);
+  if(!atomic_load_explicit(&out->full, memory_order_acquire)) {
+    cut = bottom_level(pop, n);
+    k = 0;
+    for(w = 0; w < pop->W && k < n; w++) if(pop->unsat[w] < cut) {
+	copy_bits(pop->walkers[w].bs, out->bits + (size_t)k*a->stride, sat->B);
+	k++;
+      }
+    for(w = 0; w < pop->W && k < n; w++) if(pop->unsat[w] == cut) {
+	copy_bits(pop->walkers[w].bs, out->bits + (size_t)k*a->stride, sat->B);
+	k++;
+      }
+    out->n = k;
+    atomic_store_explicit(&out->full, 1, memory_order_release);
+  }
+  //the worst walkers: all of those above the cut and enough at it
+  in = &(a->boxes[i]);
+  if(atomic_load_explicit(&in->full, memory_order_acquire)) {
+    n = in->n;
+    if(n > pop->W) n = pop->W;
+    cut = top_level(pop, n);
+    //choose them all before placing any, since placing changes unsat
+    k = 0;
+    for(w = 0; w < pop->W && k < n; w++) if(pop->unsat[w] > cut) in->slots[k++] = w;
+    for(w = 0; w < pop->W && k < n; w++) if(pop->unsat[w] == cut) in->slots[k++] = w;
+    for(k = 0; k < n; k++) place(pop, in->slots[k], in->bits + (size_t)k*a->stride, sat);
+    atomic_store_explicit(&in->full, 0, memory_order_release);
+  }
+}
@@ -0,0 +1,46 @@
+#ifndef ISLAND_H
+#define ISLAND_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "sat.h"
+#include "population.h"
+
+//The island model: replicas running on their own threads form a ring,
+//and every few timesteps each one sends copies of its best walkers to
+//the next, where they replace the worst walkers. The replicas never
+//wait for each other. Each island has a one-slot mailbox with a single
+//sender and a single receiver, handed back and forth by a flag, so a
+//migration is skipped whenever the last one has not yet been picked up.
+
+//the migrants waiting for one island
+typedef struct {
+  atomic_int full;     //set by the sender once the migrants are in, cleared by the receiver
+  int n;               //number of migrants
+  uint64_t *bits;      //the migrants' bitstrings, stride words apart
+  int *slots;          //the walkers they replace (the receiver's scratch)
+}mailbox;
+
+//the mailboxes of all of the islands, and how they migrate
+typedef struct {
+  int I;               //number of islands
+  int interval;        //timesteps between migrations
+  int size;            //walkers sent per migration
+  int stride;          //words per bitstring, padded like the walkers'
+  mailbox *boxes;      //boxes[i] is the inbox of island i
+}archipelago;
+
+//Allocate the mailboxes of I islands, each sending size walkers every
+//interval timesteps. Returns 0 on failure.
+int alloc_archipelago(archipelago *a, int I, int interval, int size, instance *sat);
+
+//free the memory allocated by alloc_archipelago
+void free_archipelago(archipelago *a);
+
+//Send copies of the best walkers of pop, which is island i, to island
+//i+1 if its inbox is empty, and let any migrants waiting in the inbox
+//of island i replace the worst walkers of pop. The histogram of pop
+//must be up to date; call population_stats afterwards.
+void migrate(archipelago *a, int i, population *pop, instance *sat);
+
+#endif
@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include "kinetic.h"
+#include "walk.h"
+
+//start the process at time zero
+void kinetic_init(kinetic *k, double duration, double vscale, uint64_t seed, uint64_t stream) {
+  k->time = 0;
+  k->duration = duration;
+  k->vscale = vscale;
+  k->hops = 0;
+  k->teleports = 0;
+  rng_seed(&k->r, seed, stream);
+}
+
+//Bring the stats of pop up to date after walker w moved from unsat
+//old. set_unsat has already widened umin and umax to take in the new
+//unsat, so only a walker leaving the min or the max calls for a rescan.
+static void event_stats(population *pop, int w, weight old) {
+  weight u;
+  u = pop->unsat[w];
+  pop->zeros += (u == 0) - (old == 0);
+  if((old == pop->umin && u > old) || (old == pop->umax && u < old)) population_stats(pop);
+}
+
+//process events until the given time
+void kinetic_run(kinetic *k, population *pop, instance *sat, double until, rng *streams) {
+  weight excess;        //total unsat above umin
+  double a, b;          //the total rate and its time derivative
+  double e;             //an exponential variate
+  double d;             //the discriminant
+  double hoprate;       //the total rate of hops
+  double s;
+  int W, w, src;
+  weight u, old, umin;
+  W = pop->W;
+  if(until > k->duration) until = k->duration;
+  //the histogram gives the total excess without a pass over the walkers
+  excess = 0;
+  if(pop->count != NULL) for(u = pop->umin; u <= pop->umax; u++) excess += (u-pop->umin)*pop->count[u];
+  else for(w = 0; w < W; w++) excess += pop->unsat[w]-pop->umin;
+  while(k->time < until && pop->zeros == 0) {
+    //The total rate is W*(1-s)+s*vscale*excess with s = time/duration,
+    //so its integral up to time+x is a*x+b*x*x/2. Setting that equal to
+    //an exponential variate gives the waiting time in a stable form.
+    s = k->time/k->duration;
+    a = W*(1.0-s) + s*k->vscale*excess;
+    b = (k->vscale*excess - W)/k->duration;
+    e = -log(1.0-rng_uniform(&k->r));
+    d = a*a + 2.0*b*e;
+    //the rate runs down to zero first, which only happens at the very end
+    if(d < 0 || a+sqrt(d) <= 0) {
+      k->time = k->duration;
+      break;
+    }
+    k->time += 2.0*e/(a+sqrt(d));
+    if(k->time >= k->duration) {
+      k->time = k->duration;
+      break;
+    }
+    s = k->time/k->duration;
+    hoprate = W*(1.0-s);
+    umin = pop->umin;
+    if(rng_uniform(&k->r)*(hoprate + s*k->vscale*excess) < hoprate) {
+      w = randint(&k->r, W);
+      old = pop->unsat[w];
+      hop_inplace(pop, w, sat, &streams[w]);
+      k->hops++;
+    }
+    else {
+      //a walker with probability proportional to unsat-umin, by rejection
+      do {
+	w = randint(&k->r, W);
+      }while(rng_uniform(&k->r)*(double)(pop->umax-pop->umin) >= (double)(pop->unsat[w]-pop->umin));
+      old = pop->unsat[w];
+      src = randint(&k->r, W);
+      teleport_to(pop, w, src, sat);
+      k->teleports++;
+    }
+    //keep the excess up to date as umin moves
+    event_stats(pop, w, old);
+    excess += pop->unsat[w] - old - (pop->umin-umin)*W;
+  }
+}
@@ -0,0 +1,38 @@
+#ifndef KINETIC_H
+#define KINETIC_H
+
+#include <stdint.h>
+#include "sat.h"
+#include "rng.h"
+#include "population.h"
+
+//An event-driven alternative to the fixed timesteps of dmcsat. In the
+//continuous-time limit each walker hops at rate 1-s and teleports at
+//rate s*vscale*(unsat-umin), independently, so the population as a
+//whole has one event at a total rate that is linear in the time until
+//some walker moves. The time of the next event is drawn by inverting
+//the integral of that rate exactly, and the event is then a hop of a
+//uniformly chosen walker or a teleport of a walker chosen in
+//proportion to its excess energy. No work is spent on walkers that
+//sit, and there is no timestep to cap.
+
+//the state of the event-driven process
+typedef struct {
+  double time;         //physical time elapsed
+  double duration;     //physical duration (hbar = 1)
+  double vscale;       //the scaling of the potential
+  long hops;           //hops so far
+  long teleports;      //teleports so far
+  rng r;               //stream for the event times and choices
+}kinetic;
+
+//start the process at time zero, drawing from stream of seed
+void kinetic_init(kinetic *k, double duration, double vscale, uint64_t seed, uint64_t stream);
+
+//Process events until k->time reaches until, the duration is over or
+//some walker has no unsatisfied clauses. A hop of walker w draws its
+//bit from streams[w]. The stats and histogram of pop must be up to
+//date, and are left so.
+void kinetic_run(kinetic *k, population *pop, instance *sat, double until, rng *streams);
+
+#endif
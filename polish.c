@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "bitstrings.h"
+#include "telemetry.h"
+#include "polish.h"
+
+//the base of the break weights that probSAT uses for uniform k-SAT
+static double break_base(int k) {
+  if(k <= 3) return 2.5;
+  if(k == 4) return 3.0;
+  if(k == 5) return 3.7;
+  if(k == 6) return 5.1;
+  return 5.4;
+}
+
+//allocate a polisher
+int alloc_polisher(polisher *p, instance *sat, weight level, int flips, int gap) {
+  int b, maxlen;
+  double cb;
+  maxlen = sat->numclauses > 0 ? sat->clauses[sat->numclauses-1].numvars : 1;
+  p->level = level;
+  p->flips = flips;
+  p->gap = gap;
+  p->numunsat = 0;
+  p->polishes = 0;
+  p->flipped = 0;
+  restart_polisher(p);
+  p->numtrue = (int *)malloc((sat->numclauses > 0 ? sat->numclauses : 1)*sizeof(int));
+  p->unsat = (int *)malloc((sat->numclauses > 0 ? sat->numclauses : 1)*sizeof(int));
+  p->where = (int *)malloc((sat->numclauses > 0 ? sat->numclauses : 1)*sizeof(int));
+  p->probs = (double *)malloc((maxlen > 0 ? maxlen : 1)*sizeof(double));
+  p->table = (double *)malloc(POLISH_BREAKS*sizeof(double));
+  p->bs = (uint64_t *)calloc(WORDS(sat->B) > 0 ? WORDS(sat->B) : 1, sizeof(uint64_t));
+  p->low = (uint64_t *)calloc(WORDS(sat->B) > 0 ? WORDS(sat->B) : 1, sizeof(uint64_t));
+  if(p->numtrue == NULL || p->unsat == NULL || p->where == NULL || p->probs == NULL || p->table == NULL
+     || p->bs == NULL || p->low == NULL) {
+    free_polisher(p);
+    return 0;
+  }
+  //the clauses are sorted by length, so the last is the longest
+  cb = break_base(maxlen);
+  for(b = 0; b < POLISH_BREAKS; b++) p->table[b] = pow(cb, -(double)b);
+  return 1;
+}
+
+//free the memory allocated by alloc_polisher
+void free_polisher(polisher *p) {
+  free(p->numtrue);
+  free(p->unsat);
+  free(p->where);
+  free(p->probs);
+  free(p->table);
+  free(p->bs);
+  free(p->low);
+}
+
+//forget the minima polished at
+void restart_polisher(polisher *p) {
+  p->floor = p->level+1;
+  p->wait = 0;
+}
+
+//the number of clauses that flipping v would leave violated
+static int breaks(polisher *p, instance *sat, int v) {
+  occurrence o;
+  int i, bit, b;
+  bit = (int)(p->bs[v>>6]>>(v&63))&1;
+  b = 0;
+  for(i = sat->start[v]; i < sat->start[v+1]; i++) {
+    o = sat->occurs[i];
+    //the literal of v is true if the bit differs from its sign
+    b += ((bit^OCCNOT(o)) & (p->numtrue[OCCCLAUSE(o)] == 1));
+  }
+  return b;
+}
+
+//flip v in the copy, keeping the true counts and the violated clauses up to date
+static void flip_var(polisher *p, instance *sat, int v) {
+  occurrence o;
+  int i, c, bit;
+  bit = (int)(p->bs[v>>6]>>(v&63))&1;
+  for(i = sat->start[v]; i < sat->start[v+1]; i++) {
+    o = sat->occurs[i];
+    c = OCCCLAUSE(o);
+    if(bit^OCCNOT(o)) {
+      if(--p->numtrue[c] == 0) {
+	p->where[c] = p->numunsat;
+	p->unsat[p->numunsat++] = c;
+	p->cost += WEIGHT(sat, c);
+      }
+    }
+    else if(p->numtrue[c]++ == 0) {
+      p->cost -= WEIGHT(sat, c);
+      p->unsat[p->where[c]] = p->unsat[--p->numunsat];
+      p->where[p->unsat[p->where[c]]] = p->where[c];
+    }
+  }
+  p->bs[v>>6] ^= 1LLU<<(v&63);
+}
+
+//run the local search from a copy of bs
+int polish(polisher *p, uint64_t *bs, instance *sat, rng *r) {
+  literal *l;
+  double sum, x;
+  int c, j, k, f, b;
+  memcpy(p->bs, bs, WORDS(sat->B)*sizeof(uint64_t));
+  p->numunsat = 0;
+  p->cost = 0;
+  for(c = 0; c < sat->numclauses; c++) {
+    p->numtrue[c] = numtrue(p->bs, sat, c);
+    if(p->numtrue[c] == 0) {
+      p->cost += WEIGHT(sat, c);
+      //an empty clause has nothing to flip, so it is never picked for repair
+      if(sat->clauses[c].numvars == 0) continue;
+      p->where[c] = p->numunsat;
+      p->unsat[p->numunsat++] = c;
+    }
+  }
+  TALLY(evals, sat->numclauses);
+  p->polishes++;
+  //the copy itself is no better than the walker it came from
+  p->lowest = p->cost;
+  copy_bits(p->bs, p->low, sat->B);
+  for(f = 0; f < p->flips && p->numunsat > 0; f++) {
+    c = p->unsat[randint(r, p->numunsat)];
+    l = sat->lits + sat->clauses[c].first;
+    k = sat->clauses[c].numvars;
+    sum = 0;
+    for(j = 0; j < k; j++) {
+      b = breaks(p, sat, LITVAR(l[j]));
+      p->probs[j] = p->table[b < POLISH_BREAKS ? b : POLISH_BREAKS-1];
+      sum += p->probs[j];
+    }
+    x = rng_uniform(r)*sum;
+    for(j = 0; j < k-1 && x >= p->probs[j]; j++) x -= p->probs[j];
+    flip_var(p, sat, LITVAR(l[j]));
+    if(p->cost < p->lowest) {
+      p->lowest = p->cost;
+      copy_bits(p->bs, p->low, sat->B);
+    }
+  }
+  TALLY(flips, f);
+  p->flipped += f;
+  //every clause weighs something, so only a solution costs nothing
+  return p->cost == 0;
+}
+
+//polish a random walker at or below the level, if it is time to
+int polish_population(polisher *p, population *pop, instance *sat, record *rec, rng *r) {
+  int w, solved;
+  if(pop->umin > p->level) return 0;
+  if(pop->umin >= p->floor && p->wait > 0) {
+    p->wait--;
+    return 0;
+  }
+  w = population_pick(pop, pop->umin, p->level, r);
+  if(w < 0) return 0;
+  if(pop->umin < p->floor) p->floor = pop->umin;
+  p->wait = p->gap-1;
+  solved = polish(p, pop->walkers[w].bs, sat, r);
+  offer_record(rec, p->low, p->lowest, sat);
+  return solved;
+}
@@ -0,0 +1,75 @@
+#ifndef POLISH_H
+#define POLISH_H
+
+#include <stdint.h>
+#include "sat.h"
+#include "rng.h"
+#include "population.h"
+
+//Near the end of a run the population often sits a few clauses from a
+//solution for a long time. Polishing hands a copy of a walker at or
+//below a low energy to a short focused local search in the style of
+//probSAT: it repeatedly picks a violated clause at random and flips one
+//of its variables, chosen with probability cb^-break, where break is
+//the number of clauses the flip would leave violated. The walker
+//itself is untouched, so the population carries on as before unless
+//the copy reaches a solution. The lowest energy the copy passes
+//through is offered to the record, which for a weighted instance can
+//lower the reported cost even without a solution.
+
+//A population that lingers just above a solution would otherwise be
+//polished every timestep, each polish costing a pass over the clauses
+//and up to flips flips, which can take longer than the walk itself.
+//So a polish is only made when the population minimum drops below
+//every minimum polished at so far in the run, or else once every gap
+//timesteps.
+
+//the state of the local search
+typedef struct {
+  weight level;        //walkers at or below this unsat are polished
+  int flips;           //flips per polish
+  int gap;             //timesteps between polishes while the minimum holds
+  int wait;            //timesteps left until the next of those
+  weight floor;        //the lowest population minimum polished at this run
+  int *numtrue;        //true literals in each clause of the copy
+  int *unsat;          //the violated clauses, leaving out empty ones
+  int numunsat;        //how many there are
+  int *where;          //the position of each violated clause in unsat
+  weight cost;         //the weight of the violated clauses of the copy
+  weight lowest;       //the lowest cost of this polish
+  uint64_t *low;       //a bitstring with it
+  double *probs;       //the weight of each variable of the clause being repaired
+  double *table;       //cb^-break for each break up to POLISH_BREAKS
+  uint64_t *bs;        //the copy
+  long polishes;       //polishes so far
+  long flipped;        //flips so far
+}polisher;
+
+//breaks beyond this all get the weight of the last
+#define POLISH_BREAKS 64
+
+//Allocate a polisher for sat that runs flips flips on walkers at or
+//below level, at most once every gap timesteps unless the population
+//minimum improves. cb is chosen by the length of the longest clause, as
+//probSAT does for uniform k-SAT. Returns 0 on failure.
+int alloc_polisher(polisher *p, instance *sat, weight level, int flips, int gap);
+
+//forget the minima polished at, at the start of a run
+void restart_polisher(polisher *p);
+
+//free the memory allocated by alloc_polisher
+void free_polisher(polisher *p);
+
+//Run the local search from a copy of bs. Returns 1 if it reaches a
+//bitstring violating no clauses, which is left in p->bs. The lowest
+//cost it reached is left in p->lowest, with a bitstring in p->low.
+int polish(polisher *p, uint64_t *bs, instance *sat, rng *r);
+
+//Called once per timestep, polish a random walker of pop whose unsat
+//is at most p->level, if there is one and it is time to, and offer the
+//best bitstring the local search reached to rec. The histogram of pop
+//must be up to date. Returns 1 if it reached a solution, which is left
+//in p->bs.
+int polish_population(polisher *p, population *pop, instance *sat, record *rec, rng *r);
+
+#endif
@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "population.h"
+#include "bitstrings.h"
+#include "telemetry.h"
+
+//allocate a population of W walkers for the instance
+int alloc_population(population *pop, int W, instance *sat, int incremental) {
+  uint64_t *bits;
+  char *caches;
+  size_t cache;         //bytes of cache per walker
+  int stride;
+  int w, u;
+  //pad to the width of the dense kernels, which read whole words
+  stride = DENSE_WORDS(sat->B);
+  if(stride == 0) stride = WORDS(sat->B);
+  cache = 0;
+  if(incremental) cache = (size_t)sat->B*sizeof(weight) + 2*(size_t)sat->numclauses*sizeof(int);
+  pop->weighted = sat->weights != NULL;
+  pop->levels = 0;
+  if(!pop->weighted || sat->total < (weight)HISTOGRAM_SPAN*W) pop->levels = (int)sat->total+1;
+  //the walker structs come first, then the bitstrings, then the caches
+  pop->walkers = (walker *)malloc(W*sizeof(walker) + (size_t)W*stride*sizeof(uint64_t) + (size_t)W*cache);
+  pop->unsat = (weight *)malloc((size_t)W*sizeof(weight));
+  pop->count = NULL;
+  if(pop->levels > 0) pop->count = (int *)malloc(pop->levels*sizeof(int));
+  if(pop->walkers == NULL || pop->unsat == NULL || (pop->levels > 0 && pop->count == NULL)) {
+    free(pop->walkers);
+    free(pop->unsat);
+    free(pop->count);
+    return 0;
+  }
+  bits = (uint64_t *)(pop->walkers + W);
+  caches = (char *)(bits + (size_t)W*stride);
+  for(w = 0; w < W; w++) {
+    pop->walkers[w].bs = bits + (size_t)w*stride;
+    init_bits(pop->walkers[w].bs, sat->B);
+    pop->walkers[w].numtrue = NULL;
+    pop->walkers[w].delta = NULL;
+    if(incremental) {
+      //the deltas come first, which keeps them aligned from walker to walker
+      pop->walkers[w].delta = (weight *)(caches + (size_t)w*cache);
+      pop->walkers[w].numtrue = (int *)(pop->walkers[w].delta + sat->B);
+    }
+    pop->unsat[w] = 0;
+  }
+  //everyone starts out at level zero
+  for(u = 0; u < pop->levels; u++) pop->count[u] = 0;
+  if(pop->count != NULL) pop->count[0] = W;
+  pop->W = W;
+  pop->umin = 0;
+  pop->umax = 0;
+  pop->zeros = W;
+  return 1;
+}
+
+//free the memory allocated by alloc_population
+void free_population(population *pop) {
+  free(pop->walkers);
+  free(pop->unsat);
+  free(pop->count);
+}
+
+//make part a view of walkers lo to hi-1 of whole
+int population_slice(population *whole, population *part, int lo, int hi) {
+  int u, w;
+  part->W = hi-lo;
+  part->walkers = whole->walkers + lo;
+  part->unsat = whole->unsat + lo;
+  part->weighted = whole->weighted;
+  part->levels = whole->levels;
+  if(part->weighted && part->levels > (weight)HISTOGRAM_SPAN*part->W) part->levels = 0;
+  part->count = NULL;
+  if(part->levels > 0) {
+    part->count = (int *)malloc(part->levels*sizeof(int));
+    if(part->count == NULL) return 0;
+  }
+  for(u = 0; u < part->levels; u++) part->count[u] = 0;
+  part->umin = part->unsat[0];
+  part->umax = part->unsat[0];
+  part->zeros = 0;
+  for(w = 0; w < part->W; w++) {
+    if(part->count != NULL) part->count[part->unsat[w]]++;
+    if(part->unsat[w] < part->umin) part->umin = part->unsat[w];
+    if(part->unsat[w] > part->umax) part->umax = part->unsat[w];
+    part->zeros += (part->unsat[w] == 0);
+  }
+  return 1;
+}
+
+//free the memory allocated by population_slice
+void free_slice(population *part) {
+  free(part->count);
+}
+
+//bring umin, umax and zeros up to date
+void population_stats(population *pop) {
+  int w;
+  TALLY(checks, 1);
+  if(pop->count == NULL) {
+    pop->umin = pop->unsat[0];
+    pop->umax = pop->unsat[0];
+    pop->zeros = 0;
+    for(w = 0; w < pop->W; w++) {
+      if(pop->unsat[w] < pop->umin) pop->umin = pop->unsat[w];
+      if(pop->unsat[w] > pop->umax) pop->umax = pop->unsat[w];
+      pop->zeros += (pop->unsat[w] == 0);
+    }
+    return;
+  }
+  while(pop->count[pop->umin] == 0) pop->umin++;
+  while(pop->count[pop->umax] == 0) pop->umax--;
+  pop->zeros = pop->count[0];
+}
+
+//return a random walker whose unsat is between lo and hi inclusive
+int population_pick(population *pop, weight lo, weight hi, rng *r) {
+  int n, w;
+  weight u;
+  if(lo < pop->umin) lo = pop->umin;
+  if(hi > pop->umax) hi = pop->umax;
+  n = 0;
+  if(pop->count != NULL) for(u = lo; u <= hi; u++) n += pop->count[u];
+  else for(w = 0; w < pop->W; w++) n += (pop->unsat[w] >= lo && pop->unsat[w] <= hi);
+  if(n == 0) return -1;
+  do {
+    w = randint(r, pop->W);
+  }while(pop->unsat[w] < lo || pop->unsat[w] > hi);
+  return w;
+}
+
+//order weights for qsort
+static int compare_weights(const void *a, const void *b) {
+  weight x, y;
+  x = *(const weight *)a;
+  y = *(const weight *)b;
+  return (x > y) - (x < y);
+}
+
+//return the n-th lowest unsat of the population
+weight population_rank(population *pop, int n) {
+  weight *sorted;
+  weight u;
+  int k;
+  if(n > pop->W) return pop->umax;
+  if(pop->count != NULL) {
+    k = 0;
+    for(u = pop->umin; u < pop->umax; u++) {
+      k += pop->count[u];
+      if(k >= n) break;
+    }
+    return u;
+  }
+  //without a histogram, sort a copy
+  sorted = (weight *)malloc((size_t)pop->W*sizeof(weight));
+  if(sorted == NULL) return pop->umax;
+  memcpy(sorted, pop->unsat, (size_t)pop->W*sizeof(weight));
+  qsort(sorted, pop->W, sizeof(weight), compare_weights);
+  u = sorted[n > 0 ? n-1 : 0];
+  free(sorted);
+  return u;
+}
+
+//allocate an empty record
+int alloc_record(record *rec, instance *sat) {
+  rec->unsat = INT64_MAX;
+  rec->bs = (uint64_t *)calloc(WORDS(sat->B) > 0 ? WORDS(sat->B) : 1, sizeof(uint64_t));
+  return rec->bs != NULL;
+}
+
+//free the memory allocated by alloc_record
+void free_record(record *rec) {
+  free(rec->bs);
+}
+
+//record the best walker of pop if it beats the record
+void update_record(record *rec, population *pop, instance *sat) {
+  int w;
+  if(pop->umin >= rec->unsat) return;
+  for(w = 0; w < pop->W; w++) {
+    if(pop->unsat[w] == pop->umin) {
+      copy_bits(pop->walkers[w].bs, rec->bs, sat->B);
+      rec->unsat = pop->umin;
+      return;
+    }
+  }
+}
+
+//record bs if it beats the record
+void offer_record(record *rec, uint64_t *bs, weight u, instance *sat) {
+  if(u >= rec->unsat) return;
+  copy_bits(bs, rec->bs, sat->B);
+  rec->unsat = u;
+}
@@ -0,0 +1,114 @@
+#ifndef POPULATION_H
+#define POPULATION_H
+
+#include <stdint.h>
+#include "sat.h"
+#include "rng.h"
+
+//The storage of one walker. The bit vector is sized to the instance
+//at runtime. In the incremental mode each walker also caches, for its
+//current bitstring, the number of true literals in every clause
+//(numtrue[2*c]) together with the xor of their variables
+//(numtrue[2*c+1]), and the change in unsat that flipping each bit
+//would cause. The energy change of a hop is then a single lookup.
+//Otherwise both are NULL. In a weighted instance unsat is the total
+//weight of the violated clauses rather than their number, and the
+//changes are weights too.
+typedef struct {
+  uint64_t *bs;        //bit vector
+  int *numtrue;        //true literals per clause (incremental mode)
+  weight *delta;       //change in unsat from flipping each bit (incremental mode)
+}walker;
+
+//A population of walkers, stored as a structure of arrays. The unsat
+//values are contiguous and apart from the bitstrings. The population
+//also keeps a histogram of its energies, updated on every move, so
+//that the min, the max and the number of winners are looked up from
+//the levels instead of scanning the walkers. In a weighted instance
+//the energies spread over many more levels, so its population keeps a
+//histogram only if there are at most HISTOGRAM_SPAN levels per walker,
+//and scans the walkers otherwise.
+typedef struct {
+  int W;               //number of walkers
+  walker *walkers;     //the storage of each walker
+  weight *unsat;       //weight of the unsatisfied clauses of each walker
+  int levels;          //number of energy levels (total weight+1), 0 without a histogram
+  int weighted;        //whether the clauses have weights
+  int *count;          //number of walkers at each level, NULL without a histogram
+  weight umin, umax;   //min and max of unsat, as of the last population_stats
+  int zeros;           //number of walkers with unsat == 0, likewise
+}population;
+
+//the most levels per walker a weighted population keeps a histogram of
+#define HISTOGRAM_SPAN 8
+
+//Allocate a population of W walkers for the instance, with all bits
+//zero. If incremental is nonzero the walkers get the caches of the
+//incremental mode. Returns 0 on failure.
+int alloc_population(population *pop, int W, instance *sat, int incremental);
+
+//free the memory allocated by alloc_population
+void free_population(population *pop);
+
+//Make part a view of walkers lo to hi-1 of whole, so that threads can
+//each update their own share of one population. The walkers and unsat
+//are shared with whole, while part gets its own histogram, built from
+//their current energies, if whole has one and a weighted part has at
+//most HISTOGRAM_SPAN levels per walker of its own. The histogram of
+//whole is not kept up to date while the parts are in use. Returns 0 on
+//failure.
+int population_slice(population *whole, population *part, int lo, int hi);
+
+//free the memory allocated by population_slice
+void free_slice(population *part);
+
+//Bring umin, umax and zeros up to date. Between calls umin and umax
+//are only kept as bounds, which this tightens using the histogram, so
+//the cost is the number of levels the min and max moved across. That
+//is small with unit weights and at most HISTOGRAM_SPAN*W otherwise.
+//Without a histogram it is a pass over the walkers.
+void population_stats(population *pop);
+
+//Return a random walker whose unsat is between lo and hi inclusive, or
+//-1 if there are none. The histogram gives the number n of candidates,
+//and uniform draws are rejected until one lands in the range, which
+//takes W/n draws on average.
+int population_pick(population *pop, weight lo, weight hi, rng *r);
+
+//Return the n-th lowest unsat of the population, counting from 1, or
+//umax if n is more than W. The histogram must be up to date.
+weight population_rank(population *pop, int n);
+
+//The lowest energy any walker has reached and a bitstring with it.
+//A weighted instance usually has no bitstring of energy zero, so the
+//solvers keep this across the whole run and report it at the end.
+typedef struct {
+  weight unsat;        //the lowest unsat so far
+  uint64_t *bs;        //a bitstring with it
+}record;
+
+//allocate a record for the instance, with nothing recorded yet; returns 0 on failure
+int alloc_record(record *rec, instance *sat);
+
+//free the memory allocated by alloc_record
+void free_record(record *rec);
+
+//If some walker of pop is below the record, record the first walker at
+//pop->umin. The stats of pop must be up to date.
+void update_record(record *rec, population *pop, instance *sat);
+
+//record bs, with unsat u, if it is below the record
+void offer_record(record *rec, uint64_t *bs, weight u, instance *sat);
+
+//set the unsat of walker w to u; every change of unsat goes through here
+static inline void set_unsat(population *pop, int w, weight u) {
+  if(pop->count != NULL) {
+    pop->count[pop->unsat[w]]--;
+    pop->count[u]++;
+  }
+  pop->unsat[w] = u;
+  if(u < pop->umin) pop->umin = u;
+  if(u > pop->umax) pop->umax = u;
+}
+
+#endif
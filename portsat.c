@@ -0,0 +1,247 @@
+/*-----------------------------------------------------------------
+  This software solves SAT or MaxSAT using a diffusion Monte Carlo
+  algorithm that mimics stoquastic adiabatic dynamics. It was
+  written by Stephen Jordan in 2016 as part of a collaboration with
+  Michael Jarret and Brad Lackey. This is the portfolio version: it
+  runs many independent replicas, possibly with different settings,
+  over a pool of threads, and stops all of them as soon as any one
+  finds a satisfying assignment. It is meant to minimize the time to
+  the first solution rather than the total CPU time. Optionally the
+  replicas form a ring of islands which periodically pass copies of
+  their best walkers on to the next island.
+  -----------------------------------------------------------------*/
+
+//On machines with very old versions of glibc (e.g. the Raritan cluster)
+//we need to define gnu_source in order to avoid warnings about implicit
+//declaration of getline() and round().
+//#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <malloc.h> //omit on mac
+#include <time.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "bitstrings.h"
+#include "sat.h"
+#include "replica.h"
+#include "island.h"
+#include "profile.h"
+#include "generate.h"
+#include "telemetry.h"
+
+//the most settings that can be given with -c
+#define MAXCONFIGS 64
+
+//the state shared by the pool
+typedef struct {
+  instance *sat;       //the SAT instance
+  replica *reps;       //the settings of each replica
+  outcome *outs;       //what each replica found
+  int N;               //number of replicas
+  atomic_int next;     //the next replica to be started
+  atomic_llong best;   //the lowest unsat found so far
+  atomic_int winner;   //the first replica to find a solution, or -1
+  atomic_int failed;   //set if some replica could not allocate memory
+}pool;
+
+//Take replicas off the queue and run them until there are none left.
+//A replica taken off after a solution has been found returns at once.
+void *work(void *arg) {
+  pool *p;
+  int r;
+  int none;
+  p = (pool *)arg;
+  while((r = atomic_fetch_add(&p->next, 1)) < p->N) {
+    if(atomic_load(&p->best) == 0) continue;
+    if(!run_replica(&p->reps[r], p->sat, &p->best, &p->outs[r])) {
+      atomic_store(&p->failed, 1);
+      continue;
+    }
+    none = -1;
+    if(p->outs[r].unsat == 0) atomic_compare_exchange_strong(&p->winner, &none, r);
+  }
+  telemetry_flush();
+  return NULL;
+}
+
+//print the command line options
+void usage() {
+  printf("Usage: portsat [-i] [-s seed] [-t threads] [-r replicas] [-k interval] [-m migrants]\n");
+  printf("               [-p profile] [-T telemetry] [-c kind,W,vscale,duration]... filename.cnf\n");
+  printf("  -i  cache clause counts and flip deltas in each walker\n");
+  printf("  -s  seed for the random number streams (default: the time)\n");
+  printf("  -t  number of threads (default: the number of cores)\n");
+  printf("  -r  number of replicas (default: the number of threads)\n");
+  printf("  -c  settings of a replica; kind is t (teleport) or s (sweep), and\n");
+  printf("      zero for W, vscale or duration selects the tuned default.\n");
+  printf("      Given more than once, the replicas cycle through the settings.\n");
+  printf("  -k  make the replicas islands, migrating walkers every interval steps\n");
+  printf("      (default: 0, no migration); islands should not outnumber threads\n");
+  printf("  -m  number of walkers each island sends per migration (default: 1)\n");
+  printf("  -p  take the defaults from the nearest entries of a profile\n");
+  printf("      written by tunesat\n");
+  printf("  -T  write the telemetry counters to a .json or .csv file\n");
+}
+
+//load a SAT instance and race the replicas to the first solution
+int main(int argc, char *argv[]) {
+  replica configs[MAXCONFIGS]; //the settings given on the command line
+  int nconfigs;                //number of settings
+  pool p;                      //the state shared by the threads
+  pthread_t *threads;          //the thread pool
+  archipelago islands;         //the mailboxes, if the replicas are islands
+  int interval;                //timesteps between migrations, or 0 for none
+  int migrants;                //walkers sent per migration
+  instance sat;                //the SAT instance
+  unsigned int seed;           //seed for rng
+  int T;                       //number of threads
+  int N;                       //number of replicas
+  int incremental;             //whether to use the incremental hop
+  int opt;                     //for parsing the command line
+  char kind;                   //the kind given with -c
+  char *profile;               //the parameter profile, or NULL
+  int tW;                      //the parameters it gives
+  double tvscale, tduration;
+  char *telemetry;             //the telemetry file, or NULL
+  int r, t, rc;
+  int winner;
+  struct timeval tv1, tv2;     //UNIX time at beginning and end
+  double walltime;             //the duration of the computation
+  gettimeofday(&tv1, NULL);
+  incremental = 0;
+  seed = time(NULL); //choose rng seed
+  T = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if(T < 1) T = 1;
+  N = 0;
+  interval = 0;
+  migrants = 1;
+  nconfigs = 0;
+  profile = NULL;
+  telemetry = NULL;
+  while((opt = getopt(argc, argv, "is:t:r:k:m:p:T:c:")) != -1) {
+    if(opt == 'i') incremental = 1;
+    else if(opt == 's') seed = strtoul(optarg, NULL, 10);
+    else if(opt == 't') T = atoi(optarg);
+    else if(opt == 'r') N = atoi(optarg);
+    else if(opt == 'k') interval = atoi(optarg);
+    else if(opt == 'm') migrants = atoi(optarg);
+    else if(opt == 'p') profile = optarg;
+    else if(opt == 'T') telemetry = optarg;
+    else if(opt == 'c' && nconfigs < MAXCONFIGS
+	    && sscanf(optarg, "%c,%i,%lf,%lf", &kind, &configs[nconfigs].W,
+		      &configs[nconfigs].vscale, &configs[nconfigs].duration) == 4
+	    && (kind == 't' || kind == 's')) {
+      configs[nconfigs].sweep = (kind == 's');
+      nconfigs++;
+    }
+    else {
+      usage();
+      return 0;
+    }
+  }
+  if(optind != argc-1 || T < 1 || N < 0 || interval < 0 || migrants < 1) {
+    usage();
+    return 0;
+  }
+  if(N == 0) N = T;
+  if(nconfigs == 0) {
+    configs[0].sweep = 0;
+    configs[0].W = 0;
+    configs[0].vscale = 0;
+    configs[0].duration = 0;
+    nconfigs = 1;
+  }
+  if(!opensat(argv[optind], &sat)) return 0;
+  //otherwise:
+  printf("%i clauses, %i variables\n", sat.numclauses, sat.B);
+  if(sat.weights != NULL) printf("weighted, hard clauses of weight %lli\n", (long long)sat.hard);
+  printf("seed = %u\n", seed); //for reproducibility
+  printf("bits = %i\n", sat.B);
+  printf("threads = %i\n", T);
+  printf("replicas = %i\n", N);
+  if(interval > 0) printf("islands migrate %i walkers every %i steps\n", migrants, interval);
+  //The defaults are the parameters of dmcsat and sweepsat, from the
+  //profile if one is given.
+  for(r = 0; r < nconfigs; r++) {
+    if(!load_profile(profile, configs[r].sweep, &sat, &tW, &tvscale, &tduration)) return 0;
+    if(configs[r].W <= 0) configs[r].W = tW;
+    if(configs[r].vscale <= 0) configs[r].vscale = tvscale;
+    if(configs[r].duration <= 0) configs[r].duration = tduration;
+    configs[r].incremental = incremental;
+    configs[r].seed = seed;
+    printf("settings %i: %s, walkers = %i, vscale = %e, duration = %e\n", r,
+	   configs[r].sweep ? "sweep" : "teleport", configs[r].W, configs[r].vscale, configs[r].duration);
+  }
+  p.sat = &sat;
+  p.N = N;
+  p.reps = (replica *)malloc(N*sizeof(replica));
+  p.outs = (outcome *)malloc(N*sizeof(outcome));
+  threads = (pthread_t *)malloc(T*sizeof(pthread_t));
+  if(p.reps == NULL || p.outs == NULL || threads == NULL
+     || (interval > 0 && !alloc_archipelago(&islands, N, interval, migrants, &sat))) {
+    printf("Unable to allocate memory for replicas.\n");
+    return 0;
+  }
+  for(r = 0; r < N; r++) {
+    p.reps[r] = configs[r%nconfigs];
+    p.reps[r].r = r;
+    p.reps[r].islands = NULL;
+    if(interval > 0) p.reps[r].islands = &islands;
+    p.outs[r].bs = (uint64_t *)malloc(WORDS(sat.B)*sizeof(uint64_t));
+    p.outs[r].unsat = -1;
+    if(p.outs[r].bs == NULL) {
+      printf("Unable to allocate memory for replicas.\n");
+      return 0;
+    }
+  }
+  if(telemetry != NULL && !telemetry_open(telemetry)) return 0;
+  atomic_init(&p.next, 0);
+  atomic_init(&p.best, sat.total);
+  atomic_init(&p.winner, -1);
+  atomic_init(&p.failed, 0);
+  for(t = 0; t < T; t++) {
+    rc = pthread_create(&threads[t], NULL, work, (void *)&p);
+    if(rc) {
+      printf("Error: return code from thread is %d\n", rc);
+      return 0;
+    }
+  }
+  for(t = 0; t < T; t++) pthread_join(threads[t], NULL);
+  telemetry_close();
+  if(atomic_load(&p.failed)) printf("Unable to allocate memory for walkers.\n");
+  for(r = 0; r < N; r++) {
+    if(p.outs[r].unsat < 0) printf("replica %i: not started\n", r);
+    else printf("replica %i: %lli violated after %i steps%s\n", r, (long long)p.outs[r].unsat, p.outs[r].steps,
+		p.outs[r].cancelled ? " (cancelled)" : "");
+  }
+  winner = atomic_load(&p.winner);
+  if(winner >= 0) {
+    printf("Replica %i found a solution:\n", winner);
+    print_bits(p.outs[winner].bs, sat.B);
+  }
+  else {
+    winner = -1;
+    for(r = 0; r < N; r++)
+      if(p.outs[r].unsat >= 0 && (winner < 0 || p.outs[r].unsat < p.outs[winner].unsat)) winner = r;
+    if(winner >= 0) {
+      printf("Best approximation found: %lli clauses violated.\n", (long long)p.outs[winner].unsat);
+      print_bits(p.outs[winner].bs, sat.B);
+    }
+  }
+  if(sat.weights != NULL && winner >= 0) print_maxsat(&sat, p.outs[winner].bs, p.outs[winner].unsat);
+  for(r = 0; r < N; r++) free(p.outs[r].bs);
+  if(interval > 0) free_archipelago(&islands);
+  free(p.reps);
+  free(p.outs);
+  free(threads);
+  freesat(&sat);
+  gettimeofday(&tv2, NULL);
+  walltime = (double)(tv2.tv_usec - tv1.tv_usec)/1000000 + (double)(tv2.tv_sec - tv1.tv_sec);
+  printf("walltime: %f seconds\n", walltime);
+  return 0;
+}
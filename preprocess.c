@@ -0,0 +1,519 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bitstrings.h"
+#include "preprocess.h"
+
+//most rounds of simplification
+#define PREPROCESS_ROUNDS 16
+
+//variables with more occurrences than this of either sign are not
+//eliminated, which bounds the resolvents tried for each at its square
+#define ELIM_OCCS 16
+
+//what the value of a variable is while simplifying
+#define FREE (-1)
+#define ELIMINATED 2
+
+//the clauses containing one literal
+typedef struct {
+  int *ids;
+  int n;
+  int cap;
+}occlist;
+
+//a clause being simplified, the run of size literals at lits[first]
+typedef struct {
+  size_t first;
+  int size;
+  int dead;
+}pclause;
+
+//the instance while it is being simplified
+typedef struct {
+  int B;
+  pclause *clauses;    //the clauses, dead or alive
+  int numclauses;
+  int capclauses;
+  literal *lits;       //their literals
+  size_t numlits;
+  size_t caplits;
+  occlist *occ;        //the live clauses containing each literal, indexed by the literal
+  signed char *value;  //0 or 1 once fixed, FREE or ELIMINATED
+  literal *queue;      //units waiting to be propagated
+  int qhead, qtail, qcap;
+  int *mark;           //stamp of the last clause each literal was marked in
+  int stamp;
+  literal *res;        //the resolvents of the variable being eliminated
+  size_t numres, capres;
+  int *reslen;         //and their lengths
+  int capreslen;
+  int conflict;        //set once the empty clause is derived
+  int nomem;           //set if an allocation failed
+  int units, pures, subsumed, eliminated;
+  int numelim;         //the reconstruction stack, as in preprocessor
+  int *elim;
+  int capelim;
+  int *elimstart;
+  int capstart;
+  literal *stack;
+  size_t numstack, capstack;
+}simplifier;
+
+//Make room for need elements of size bytes in *p, which has room for
+//*cap, at least doubling it. Returns 0 if out of memory.
+static int grow(void **p, size_t *cap, size_t need, size_t size) {
+  size_t n;
+  void *q;
+  if(need <= *cap) return 1;
+  n = *cap > 0 ? *cap : 16;
+  while(n < need) n *= 2;
+  q = realloc(*p, n*size);
+  if(q == NULL) return 0;
+  *p = q;
+  *cap = n;
+  return 1;
+}
+
+//the same for an int capacity
+static int grow_int(void **p, int *cap, size_t need, size_t size) {
+  size_t c;
+  c = *cap;
+  if(!grow(p, &c, need, size)) return 0;
+  *cap = (int)c;
+  return 1;
+}
+
+//queue literal l to be made true
+static void push_unit(simplifier *s, literal l) {
+  if(!grow_int((void **)&s->queue, &s->qcap, s->qtail+1, sizeof(literal))) {
+    s->nomem = 1;
+    return;
+  }
+  s->queue[s->qtail++] = l;
+}
+
+//add clause c to the occurrences of l
+static void occ_add(simplifier *s, literal l, int c) {
+  occlist *o;
+  o = &s->occ[l];
+  if(!grow_int((void **)&o->ids, &o->cap, o->n+1, sizeof(int))) {
+    s->nomem = 1;
+    return;
+  }
+  o->ids[o->n++] = c;
+}
+
+//remove clause c from the occurrences of l
+static void occ_remove(simplifier *s, literal l, int c) {
+  occlist *o;
+  int i;
+  o = &s->occ[l];
+  for(i = 0; i < o->n && o->ids[i] != c; i++);
+  if(i < o->n) o->ids[i] = o->ids[--o->n];
+}
+
+//add the clause of the k literals at l, which are distinct and on
+//distinct variables
+static void add_clause(simplifier *s, literal *l, int k) {
+  pclause *c;
+  int j;
+  if(k == 0) {
+    s->conflict = 1;
+    return;
+  }
+  if(!grow_int((void **)&s->clauses, &s->capclauses, s->numclauses+1, sizeof(pclause))
+     || !grow((void **)&s->lits, &s->caplits, s->numlits+k, sizeof(literal))) {
+    s->nomem = 1;
+    return;
+  }
+  c = &s->clauses[s->numclauses];
+  c->first = s->numlits;
+  c->size = k;
+  c->dead = 0;
+  memcpy(s->lits + s->numlits, l, k*sizeof(literal));
+  s->numlits += k;
+  for(j = 0; j < k; j++) occ_add(s, l[j], s->numclauses);
+  if(k == 1) push_unit(s, l[0]);
+  s->numclauses++;
+}
+
+//remove clause c
+static void remove_clause(simplifier *s, int c) {
+  pclause *cl;
+  int j;
+  cl = &s->clauses[c];
+  cl->dead = 1;
+  for(j = 0; j < cl->size; j++) occ_remove(s, s->lits[cl->first+j], c);
+}
+
+//Make literal l true: its clauses are satisfied and go, and its
+//negation is dropped from the clauses holding it, which may leave units
+//or, if one becomes empty, a conflict.
+static void fix(simplifier *s, literal l) {
+  occlist *o;
+  pclause *cl;
+  literal *cl_lits;
+  int i, j;
+  s->value[LITVAR(l)] = 1-LITNOT(l);
+  while(s->occ[l].n > 0) remove_clause(s, s->occ[l].ids[0]);
+  o = &s->occ[l^1];
+  for(i = 0; i < o->n; i++) {
+    cl = &s->clauses[o->ids[i]];
+    cl_lits = s->lits + cl->first;
+    for(j = 0; cl_lits[j] != (l^1); j++);
+    cl_lits[j] = cl_lits[--cl->size];
+    if(cl->size == 0) s->conflict = 1;
+    else if(cl->size == 1) push_unit(s, cl_lits[0]);
+  }
+  o->n = 0;
+}
+
+//propagate the queued units until none are left or there is a conflict
+static void propagate(simplifier *s) {
+  literal l;
+  int v;
+  while(s->qhead < s->qtail && !s->conflict && !s->nomem) {
+    l = s->queue[s->qhead++];
+    v = LITVAR(l);
+    if(s->value[v] == FREE) {
+      fix(s, l);
+      s->units++;
+    }
+    else if(s->value[v] != 1-LITNOT(l)) s->conflict = 1;
+  }
+  s->qhead = s->qtail = 0;
+}
+
+//make every pure literal true
+static void eliminate_pure(simplifier *s) {
+  int v;
+  for(v = 0; v < s->B; v++) {
+    if(s->value[v] != FREE) continue;
+    if(s->occ[LIT(v,0)].n > 0 && s->occ[LIT(v,1)].n == 0) fix(s, LIT(v,0));
+    else if(s->occ[LIT(v,1)].n > 0 && s->occ[LIT(v,0)].n == 0) fix(s, LIT(v,1));
+    else continue;
+    s->pures++;
+  }
+}
+
+//Remove every clause that contains another, including duplicates. A
+//clause is only compared with the clauses holding its rarest literal.
+static void eliminate_subsumed(simplifier *s) {
+  pclause *c, *d;
+  occlist *o;
+  literal *l;
+  literal best;
+  int i, j, k, n;
+  for(i = 0; i < s->numclauses; i++) {
+    c = &s->clauses[i];
+    if(c->dead) continue;
+    s->stamp++;
+    l = s->lits + c->first;
+    best = l[0];
+    for(j = 0; j < c->size; j++) {
+      s->mark[l[j]] = s->stamp;
+      if(s->occ[l[j]].n < s->occ[best].n) best = l[j];
+    }
+    o = &s->occ[best];
+    k = 0;
+    while(k < o->n) {
+      d = &s->clauses[o->ids[k]];
+      if(o->ids[k] == i || d->size < c->size) {
+	k++;
+	continue;
+      }
+      n = 0;
+      for(j = 0; j < d->size; j++) n += s->mark[s->lits[d->first+j]] == s->stamp;
+      if(n == c->size) {
+	//this takes it out of o, so k now holds the next clause
+	remove_clause(s, o->ids[k]);
+	s->subsumed++;
+      }
+      else k++;
+    }
+  }
+}
+
+//Resolve the clauses of v, that is p, against those of not v, n,
+//into s->res, stopping early if there are more resolvents than the
+//clauses they would replace, or more literals. Returns the number of
+//resolvents, or -1 if there are too many.
+static int resolve(simplifier *s, int v, occlist *p, occlist *n) {
+  pclause *c, *d;
+  literal *l;
+  size_t before, oldlits;
+  int i, k, j, count, taut;
+  oldlits = 0;
+  for(i = 0; i < p->n; i++) oldlits += s->clauses[p->ids[i]].size;
+  for(i = 0; i < n->n; i++) oldlits += s->clauses[n->ids[i]].size;
+  s->numres = 0;
+  count = 0;
+  for(i = 0; i < p->n; i++) {
+    c = &s->clauses[p->ids[i]];
+    for(k = 0; k < n->n; k++) {
+      d = &s->clauses[n->ids[k]];
+      if(!grow((void **)&s->res, &s->capres, s->numres+c->size+d->size, sizeof(literal))) {
+	s->nomem = 1;
+	return -1;
+      }
+      before = s->numres;
+      s->stamp++;
+      l = s->lits + c->first;
+      for(j = 0; j < c->size; j++) {
+	if(LITVAR(l[j]) == v) continue;
+	s->mark[l[j]] = s->stamp;
+	s->res[s->numres++] = l[j];
+      }
+      l = s->lits + d->first;
+      taut = 0;
+      for(j = 0; j < d->size && !taut; j++) {
+	if(LITVAR(l[j]) == v || s->mark[l[j]] == s->stamp) continue;
+	if(s->mark[l[j]^1] == s->stamp) taut = 1;
+	else s->res[s->numres++] = l[j];
+      }
+      if(taut) {
+	s->numres = before;
+	continue;
+      }
+      if(!grow_int((void **)&s->reslen, &s->capreslen, count+1, sizeof(int))) {
+	s->nomem = 1;
+	return -1;
+      }
+      s->reslen[count++] = (int)(s->numres-before);
+      if(count > p->n+n->n || s->numres > oldlits) return -1;
+    }
+  }
+  return count;
+}
+
+//push clause c onto the reconstruction stack
+static int save_clause(simplifier *s, pclause *c) {
+  if(!grow((void **)&s->stack, &s->capstack, s->numstack+c->size+1, sizeof(literal))) return 0;
+  memcpy(s->stack + s->numstack, s->lits + c->first, c->size*sizeof(literal));
+  s->numstack += c->size;
+  s->stack[s->numstack++] = NOLIT;
+  return 1;
+}
+
+//Eliminate each variable whose resolvents are no bigger than its
+//clauses, saving those clauses for reconstruction.
+static void eliminate_variables(simplifier *s) {
+  occlist *p, *n;
+  literal *r;
+  int v, i, count;
+  for(v = 0; v < s->B && !s->conflict && !s->nomem; v++) {
+    if(s->value[v] != FREE) continue;
+    p = &s->occ[LIT(v,0)];
+    n = &s->occ[LIT(v,1)];
+    if(p->n == 0 || n->n == 0 || p->n > ELIM_OCCS || n->n > ELIM_OCCS) continue;
+    count = resolve(s, v, p, n);
+    if(count < 0) continue;
+    if(!grow_int((void **)&s->elim, &s->capelim, s->numelim+1, sizeof(int))
+       || !grow_int((void **)&s->elimstart, &s->capstart, s->numelim+2, sizeof(int))) {
+      s->nomem = 1;
+      return;
+    }
+    s->elim[s->numelim] = v;
+    s->elimstart[s->numelim] = (int)s->numstack;
+    for(i = 0; i < p->n; i++) if(!save_clause(s, &s->clauses[p->ids[i]])) s->nomem = 1;
+    for(i = 0; i < n->n; i++) if(!save_clause(s, &s->clauses[n->ids[i]])) s->nomem = 1;
+    if(s->nomem) return;
+    s->numelim++;
+    s->elimstart[s->numelim] = (int)s->numstack;
+    while(p->n > 0) remove_clause(s, p->ids[0]);
+    while(n->n > 0) remove_clause(s, n->ids[0]);
+    s->value[v] = ELIMINATED;
+    s->eliminated++;
+    r = s->res;
+    for(i = 0; i < count; i++) {
+      add_clause(s, r, s->reslen[i]);
+      r += s->reslen[i];
+    }
+    propagate(s);
+  }
+}
+
+//free the memory of a simplifier
+static void free_simplifier(simplifier *s) {
+  int i;
+  if(s->occ != NULL) for(i = 0; i < 2*s->B; i++) free(s->occ[i].ids);
+  free(s->occ);
+  free(s->clauses);
+  free(s->lits);
+  free(s->value);
+  free(s->queue);
+  free(s->mark);
+  free(s->res);
+  free(s->reslen);
+  free(s->elim);
+  free(s->elimstart);
+  free(s->stack);
+}
+
+//Build the simplified instance out of the live clauses of s, numbering
+//the variables that still occur in them from 0, and fill in pre.
+//Returns 0 if out of memory.
+static int build(simplifier *s, instance *sat, preprocessor *pre) {
+  int *newvar;
+  pclause *c;
+  int v, i, j, k;
+  newvar = (int *)malloc((s->B > 0 ? s->B : 1)*sizeof(int));
+  pre->map = (int *)malloc((s->B > 0 ? s->B : 1)*sizeof(int));
+  pre->fixed = (signed char *)malloc(s->B > 0 ? s->B : 1);
+  pre->bs = (uint64_t *)malloc((WORDS(s->B) > 0 ? WORDS(s->B) : 1)*sizeof(uint64_t));
+  if(newvar == NULL || pre->map == NULL || pre->fixed == NULL || pre->bs == NULL) {
+    free(newvar);
+    return 0;
+  }
+  sat->B = 0;
+  for(v = 0; v < s->B; v++) {
+    newvar[v] = -1;
+    pre->fixed[v] = -1;
+    if(s->value[v] == 0 || s->value[v] == 1) pre->fixed[v] = s->value[v];
+    else if(s->value[v] == FREE && s->occ[LIT(v,0)].n + s->occ[LIT(v,1)].n == 0) pre->fixed[v] = 0;
+    else if(s->value[v] == FREE) {
+      newvar[v] = sat->B;
+      pre->map[sat->B++] = v;
+    }
+  }
+  sat->numclauses = 0;
+  sat->numlits = 0;
+  for(i = 0; i < s->numclauses; i++) {
+    if(s->clauses[i].dead) continue;
+    sat->numclauses++;
+    sat->numlits += s->clauses[i].size;
+  }
+  sat->clauses = (clause *)malloc((sat->numclauses > 0 ? sat->numclauses : 1)*sizeof(clause));
+  sat->lits = (literal *)malloc((sat->numlits > 0 ? sat->numlits : 1)*sizeof(literal));
+  sat->weights = NULL;
+  if(sat->clauses == NULL || sat->lits == NULL) {
+    free(newvar);
+    free(sat->clauses);
+    free(sat->lits);
+    return 0;
+  }
+  k = 0;
+  j = 0;
+  for(i = 0; i < s->numclauses; i++) {
+    c = &s->clauses[i];
+    if(c->dead) continue;
+    sat->clauses[k].first = j;
+    sat->clauses[k].numvars = c->size;
+    for(v = 0; v < c->size; v++) {
+      sat->lits[j++] = LIT(newvar[LITVAR(s->lits[c->first+v])], LITNOT(s->lits[c->first+v]));
+    }
+    k++;
+  }
+  free(newvar);
+  pre->vars = sat->B;
+  //the reconstruction stack passes to pre
+  pre->numelim = s->numelim;
+  pre->elim = s->elim;
+  pre->elimstart = s->elimstart;
+  pre->stack = s->stack;
+  s->elim = NULL;
+  s->elimstart = NULL;
+  s->stack = NULL;
+  return compilesat(sat);
+}
+
+//simplify sat, keeping what is needed to undo it in pre
+int preprocess(instance *sat, preprocessor *pre) {
+  simplifier s;
+  instance reduced;
+  int i, j, round, before;
+  memset(pre, 0, sizeof(preprocessor));
+  pre->B = sat->B;
+  if(sat->weights != NULL) {
+    printf("weighted instance, not preprocessed\n");
+    return 1;
+  }
+  memset(&s, 0, sizeof(simplifier));
+  s.B = sat->B;
+  s.occ = (occlist *)calloc(2*(size_t)sat->B+1, sizeof(occlist));
+  s.value = (signed char *)malloc(sat->B > 0 ? sat->B : 1);
+  s.mark = (int *)calloc(2*(size_t)sat->B+1, sizeof(int));
+  if(s.occ == NULL || s.value == NULL || s.mark == NULL) s.nomem = 1;
+  else memset(s.value, FREE, sat->B);
+  for(i = 0; i < sat->numclauses && !s.nomem; i++) add_clause(&s, sat->lits + sat->clauses[i].first, sat->clauses[i].numvars);
+  propagate(&s);
+  for(round = 0; round < PREPROCESS_ROUNDS && !s.conflict && !s.nomem; round++) {
+    before = s.units + s.pures + s.subsumed + s.eliminated;
+    eliminate_pure(&s);
+    eliminate_subsumed(&s);
+    eliminate_variables(&s);
+    propagate(&s);
+    if(s.units + s.pures + s.subsumed + s.eliminated == before) break;
+  }
+  if(s.nomem) {
+    printf("Memory allocation error in preprocess.\n");
+    free_simplifier(&s);
+    freesat(sat);
+    return 0;
+  }
+  if(s.conflict) {
+    printf("preprocessing found the instance unsatisfiable, walking it as it is\n");
+    free_simplifier(&s);
+    return 1;
+  }
+  memset(&reduced, 0, sizeof(instance));
+  if(!build(&s, &reduced, pre)) {
+    printf("Memory allocation error in preprocess.\n");
+    free_simplifier(&s);
+    free_preprocessor(pre);
+    freesat(sat);
+    return 0;
+  }
+  printf("preprocessing: %i units, %i pure literals, %i subsumed clauses, %i eliminated variables\n",
+	 s.units, s.pures, s.subsumed, s.eliminated);
+  for(i = j = 0; i < s.B; i++) j += pre->fixed[i] >= 0;
+  printf("%i clauses, %i variables left, %i fixed\n", reduced.numclauses, reduced.B, j);
+  free_simplifier(&s);
+  freesat(sat);
+  *sat = reduced;
+  pre->active = 1;
+  return 1;
+}
+
+//extend bs to a bitstring of the original instance
+uint64_t *reconstruct(preprocessor *pre, uint64_t *bs) {
+  literal *l;
+  int i, v, sat;
+  memset(pre->bs, 0, WORDS(pre->B)*sizeof(uint64_t));
+  for(v = 0; v < pre->B; v++) if(pre->fixed[v] == 1) pre->bs[v>>6] |= 1LLU<<(v&63);
+  for(i = 0; i < pre->vars; i++) if(extract(bs, i, pre->vars)) pre->bs[pre->map[i]>>6] |= 1LLU<<(pre->map[i]&63);
+  //each eliminated variable starts at 0 and becomes 1 if that leaves one of its clauses violated
+  for(i = pre->numelim-1; i >= 0; i--) {
+    v = pre->elim[i];
+    sat = 0;
+    for(l = pre->stack + pre->elimstart[i]; l < pre->stack + pre->elimstart[i+1]; l++) {
+      if(*l == NOLIT) {
+	if(!sat) {
+	  pre->bs[v>>6] |= 1LLU<<(v&63);
+	  break;
+	}
+	sat = 0;
+      }
+      else if(LITTRUE(pre->bs, *l)) sat = 1;
+    }
+  }
+  return pre->bs;
+}
+
+//print bs as a bitstring of the original instance
+void print_original(preprocessor *pre, uint64_t *bs, int B) {
+  if(pre == NULL || !pre->active) print_bits(bs, B);
+  else print_bits(reconstruct(pre, bs), pre->B);
+}
+
+//free the memory allocated by preprocess
+void free_preprocessor(preprocessor *pre) {
+  free(pre->map);
+  free(pre->fixed);
+  free(pre->elim);
+  free(pre->elimstart);
+  free(pre->stack);
+  free(pre->bs);
+  memset(pre, 0, sizeof(preprocessor));
+}
@@ -0,0 +1,57 @@
+#ifndef PREPROCESS_H
+#define PREPROCESS_H
+
+#include <stdint.h>
+#include "sat.h"
+
+//Before the walk, an instance can be shrunk by unit propagation,
+//pure literal elimination, removal of duplicate and subsumed clauses
+//and bounded variable elimination, which resolves a variable away
+//whenever its resolvents have no more clauses and no more literals
+//than the clauses they replace. Every bit and clause removed makes
+//every hop and every randomize pass cheaper. The walk then runs on the
+//smaller instance, and its bitstrings are extended back to satisfying
+//assignments of the original instance: fixed variables take their
+//values, and eliminated ones are set, in the reverse of the order they
+//were eliminated in, to satisfy the clauses they were resolved out of.
+
+//what it takes to turn a bitstring of the simplified instance back into
+//one of the original
+typedef struct {
+  int active;          //0 if the instance was left as it was
+  int B;               //bits of the original instance
+  int vars;            //and of the simplified one
+  int *map;            //the original variable of each variable of the simplified instance
+  signed char *fixed;  //the value of each original variable fixed by the simplification, -1 if none
+  int numelim;         //how many variables were eliminated
+  int *elim;           //the eliminated variables, in order
+  int *elimstart;      //the clauses of elim[i] are stack[elimstart[i]] to stack[elimstart[i+1]-1]
+  literal *stack;      //those clauses, each ended by NOLIT
+  uint64_t *bs;        //room for one bitstring of the original instance
+}preprocessor;
+
+//ends each clause in the stack of a preprocessor
+#define NOLIT ((literal)-1)
+
+//Simplify sat in place, filling in pre, and print what was removed.
+//Weighted instances are left as they are, since the simplifications
+//only preserve satisfiability, not the weight of what is violated, and
+//so are instances found to be unsatisfiable, so that the walk can still
+//minimize the number of violated clauses. In either case pre->active is
+//0. Returns 0 on failure, having freed sat.
+int preprocess(instance *sat, preprocessor *pre);
+
+//Extend the bitstring bs of the simplified instance to one of the
+//original, in pre->bs, and return it. If bs satisfies the simplified
+//instance, the result satisfies the original. bs is not read if the
+//simplified instance has no bits left, and may then be NULL.
+uint64_t *reconstruct(preprocessor *pre, uint64_t *bs);
+
+//Print bs, which has B bits, as a bitstring of the original instance.
+//pre may be NULL if there was no simplification.
+void print_original(preprocessor *pre, uint64_t *bs, int B);
+
+//free the memory allocated by preprocess
+void free_preprocessor(preprocessor *pre);
+
+#endif
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "profile.h"
+
+//fill in the key of the instance
+void instance_key(instance *sat, setting *st) {
+  int c;
+  st->B = sat->B;
+  st->ratio = (double)sat->numclauses/(double)sat->B;
+  st->k = 0;
+  for(c = 0; c < sat->numclauses; c++) if(sat->clauses[c].numvars > st->k) st->k = sat->clauses[c].numvars;
+}
+
+//the mean weight of the soft clauses, 1 if there are none
+static double mean_weight(instance *sat) {
+  double total;
+  int c, n;
+  total = 0;
+  n = 0;
+  for(c = 0; c < sat->numclauses; c++) {
+    if(sat->weights[c] >= sat->hard) continue;
+    total += (double)sat->weights[c];
+    n++;
+  }
+  return n > 0 ? total/n : 1.0;
+}
+
+//the defaults
+void default_params(int sweep, instance *sat, int *W, double *vscale, double *duration) {
+  if(sweep) {
+    //the following W and vscale are copied from Brad's code
+    *W = 128;
+    *vscale = 1.0;
+    *duration = 120.0*exp(0.053*(double)sat->B);
+    if(sat->B == 150) *duration = 10000;
+  }
+  else {
+    *W = 100;
+    *vscale = 75.0/(double)sat->B;
+    *duration = 188.0*exp(0.053*(double)sat->B);
+  }
+  if(sat->weights != NULL) *vscale /= mean_weight(sat);
+}
+
+//the parameters that st gives for the instance
+void apply_setting(setting *st, instance *sat, int *W, double *vscale, double *duration) {
+  default_params(st->sweep, sat, W, vscale, duration);
+  *W = st->W;
+  *vscale *= st->vfactor;
+  *duration *= st->dfactor;
+}
+
+//whether two entries are for the same kind and key
+static int same_key(setting *a, setting *b) {
+  return a->sweep == b->sweep && a->B == b->B && a->k == b->k && fabs(a->ratio-b->ratio) < RATIO_TOLERANCE;
+}
+
+//How far apart two keys are. The scale of the instance matters in
+//proportion, the ratio in absolute terms, and a different clause
+//length outweighs both.
+static double distance(setting *a, setting *b) {
+  return fabs(log((double)a->B/(double)b->B)) + fabs(a->ratio-b->ratio) + (a->k != b->k ? 100.0 : 0);
+}
+
+//read the entries of a profile
+int read_profile(char *filename, setting **list, int *n) {
+  FILE *fp;
+  char line[256];
+  char kind[16];
+  setting st;
+  int cap, lineno;
+  *list = NULL;
+  *n = 0;
+  fp = fopen(filename, "r");
+  if(fp == NULL) return 1;
+  cap = 0;
+  lineno = 0;
+  while(fgets(line, sizeof(line), fp) != NULL) {
+    lineno++;
+    if(line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') continue;
+    if(sscanf(line, "%15s %i %lf %i %i %lf %lf", kind, &st.B, &st.ratio, &st.k, &st.W,
+	      &st.vfactor, &st.dfactor) != 7 || (strcmp(kind, "teleport") != 0 && strcmp(kind, "sweep") != 0)
+       || st.B < 1 || st.W < 1 || st.vfactor <= 0 || st.dfactor <= 0) {
+      printf("Malformed entry on line %i of profile %s.\n", lineno, filename);
+      fclose(fp);
+      free(*list);
+      return 0;
+    }
+    st.sweep = (strcmp(kind, "sweep") == 0);
+    if(*n == cap) {
+      cap = 2*cap + 16;
+      *list = (setting *)realloc(*list, cap*sizeof(setting));
+      if(*list == NULL) {
+	printf("Memory allocation error in read_profile.\n");
+	fclose(fp);
+	return 0;
+      }
+    }
+    (*list)[(*n)++] = st;
+  }
+  fclose(fp);
+  return 1;
+}
+
+//set the parameters from the nearest entry of the profile
+int load_profile(char *filename, int sweep, instance *sat, int *W, double *vscale, double *duration) {
+  setting *list;
+  setting key;
+  int n, i, best;
+  default_params(sweep, sat, W, vscale, duration);
+  if(filename == NULL) return 1;
+  if(!read_profile(filename, &list, &n)) return 0;
+  instance_key(sat, &key);
+  best = -1;
+  for(i = 0; i < n; i++)
+    if(list[i].sweep == sweep && (best < 0 || distance(&list[i], &key) < distance(&list[best], &key))) best = i;
+  if(best >= 0) {
+    apply_setting(&list[best], sat, W, vscale, duration);
+    printf("profile entry: B = %i, ratio = %.2f, k = %i\n", list[best].B, list[best].ratio, list[best].k);
+  }
+  else printf("no %s entry in profile %s, using defaults\n", sweep ? "sweep" : "teleport", filename);
+  free(list);
+  return 1;
+}
+
+//write one entry of a profile
+static void write_entry(FILE *fp, setting *st) {
+  fprintf(fp, "%s %i %.2f %i %i %.4f %.4f\n", st->sweep ? "sweep" : "teleport", st->B, st->ratio, st->k,
+	  st->W, st->vfactor, st->dfactor);
+}
+
+//add st to the profile
+int save_profile(char *filename, setting *st) {
+  FILE *fp;
+  setting *list;
+  int n, i, found;
+  if(!read_profile(filename, &list, &n)) return 0;
+  fp = fopen(filename, "w");
+  if(fp == NULL) {
+    printf("Unable to write profile %s.\n", filename);
+    free(list);
+    return 0;
+  }
+  fprintf(fp, "# kind B ratio k W vfactor dfactor\n");
+  found = 0;
+  for(i = 0; i < n; i++) {
+    if(same_key(&list[i], st)) {
+      write_entry(fp, st);
+      found = 1;
+    }
+    else write_entry(fp, &list[i]);
+  }
+  if(!found) write_entry(fp, st);
+  fclose(fp);
+  free(list);
+  return 1;
+}
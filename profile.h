@@ -0,0 +1,56 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "sat.h"
+
+//A parameter profile records, for families of instances, the settings
+//that tunesat found to minimize the median time to solution. A family
+//is keyed by the number of bits B, the ratio of clauses to variables
+//and the clause length k. The file is plain text, one entry per line:
+//  kind B ratio k W vfactor dfactor
+//where kind is teleport or sweep, and vscale and duration are given as
+//multiples of the tuned defaults, so that an entry still makes sense
+//for instances of nearby size. Lines starting with # are comments.
+//A solver uses the entry of its kind whose key is nearest its instance.
+
+//one entry of a profile
+typedef struct {
+  int sweep;           //whether it is for sweeping rather than teleporting
+  int B;               //the key: number of bits,
+  double ratio;        //clauses per variable,
+  int k;               //and the longest clause
+  int W;               //number of walkers
+  double vfactor;      //vscale as a multiple of the default
+  double dfactor;      //duration as a multiple of the default
+}setting;
+
+//Ratios closer than this belong to one family, both when tunesat
+//groups its instances and when save_profile replaces an entry.
+#define RATIO_TOLERANCE 0.05
+
+//fill in the key of the instance
+void instance_key(instance *sat, setting *st);
+
+//The defaults, which were obtained by trial and error for random 3SAT
+//at the sat/unsat phase transition. For a weighted instance vscale is
+//divided by the mean weight of the soft clauses, so that a typical
+//clause carries the potential an unweighted one would.
+void default_params(int sweep, instance *sat, int *W, double *vscale, double *duration);
+
+//the parameters that st gives for the instance
+void apply_setting(setting *st, instance *sat, int *W, double *vscale, double *duration);
+
+//Read the entries of a profile into a list allocated with malloc. A
+//missing file is an empty profile. Returns 0 if the file is malformed.
+int read_profile(char *filename, setting **list, int *n);
+
+//Set the parameters for the instance from the nearest entry of the
+//given kind in the profile, or to the defaults if filename is NULL or
+//there is no entry of that kind. Returns 0 if the profile is malformed.
+int load_profile(char *filename, int sweep, instance *sat, int *W, double *vscale, double *duration);
+
+//Add st to the profile, replacing any entry with the same kind and key.
+//Returns 0 if the profile could not be read or written.
+int save_profile(char *filename, setting *st);
+
+#endif
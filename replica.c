@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "bitstrings.h"
+#include "replica.h"
+#include "walk.h"
+#include "sample.h"
+#include "telemetry.h"
+
+//lower *best to u, unless some replica has already gone lower
+static void lower_best(atomic_llong *best, weight u) {
+  long long b;
+  b = atomic_load_explicit(best, memory_order_relaxed);
+  while(u < b && !atomic_compare_exchange_weak_explicit(best, &b, u, memory_order_relaxed,
+							   memory_order_relaxed));
+}
+
+//one timestep of the teleporting process, as in dmcsat
+static int teleport_step(population *pop, actions *act, staging *st, double s, double dt,
+			 double vscale, instance *sat, rng *streams) {
+  int i, w;
+  sample_actions(act, pop, pop->umin, (1.0-s)*dt, dt*s*vscale, streams);
+  if(!teleport_inplace(pop, act, st, sat, streams)) return 0;
+  for(i = 0; i < act->nhop; i++) {
+    w = act->hops[i];
+    hop_inplace(pop, w, sat, &streams[w]);
+  }
+  return 1;
+}
+
+//run the replica until it is done or some replica finds a solution
+int run_replica(replica *rep, instance *sat, atomic_llong *best, outcome *out) {
+  population pop;
+  population *cur;      //the locations of walkers, updated in place
+  actions act;          //the actions of a teleporting step
+  staging st;           //copies of teleport sources about to be overwritten
+  sweeper sw;           //the lists of a sweeping step
+  rng master;           //stream for the sweep order
+  rng *streams;         //the random number stream of each walker
+  uint64_t base;        //the first stream of this replica
+  int incremental;
+  int w, ok;
+  double s, dt, time;
+  double last_output;   //the time of the last telemetry sample
+  record rec;           //the best walker so far, kept in out->bs
+  incremental = rep->incremental && !rep->sweep;
+  streams = (rng *)malloc(rep->W*sizeof(rng));
+  if(streams == NULL || !alloc_population(&pop, rep->W, sat, incremental) || !alloc_actions(&act, rep->W)
+     || !alloc_staging(&st, &pop, sat) || !alloc_sweeper(&sw, rep->W)) return 0;
+  base = (uint64_t)rep->r<<32;
+  rng_seed(&master, rep->seed, base);
+  for(w = 0; w < rep->W; w++) rng_seed(&streams[w], rep->seed, base+w+rep->sweep);
+  cur = &pop;
+  randomize(cur, sat, streams);
+  population_stats(cur);
+  lower_best(best, cur->umin);
+  rec.unsat = INT64_MAX;
+  rec.bs = out->bs;
+  update_record(&rec, cur, sat);
+  out->steps = 0;
+  out->cancelled = 0;
+  time = 0;
+  last_output = 0;
+  while(time < rep->duration && cur->zeros == 0) {
+    //another replica has found a solution
+    if(atomic_load_explicit(best, memory_order_relaxed) == 0) {
+      out->cancelled = 1;
+      break;
+    }
+    s = time/rep->duration;
+    dt = 0.99/(1.0-s+s*rep->vscale*(double)(cur->umax-cur->umin));
+    TALLY(steps, 1);
+    TALLY_DT(dt);
+    if(time == 0 || time - last_output >= rep->duration/100.0) {
+      telemetry_sample(rep->r, time, s, dt, cur->umin, cur->umax);
+      last_output = time;
+    }
+    ok = 1;
+    if(rep->sweep) sweep_inplace(cur, &sw, (1.0-s)*dt, dt*s*rep->vscale, sat, &master, streams);
+    else ok = teleport_step(cur, &act, &st, s, dt, rep->vscale, sat, streams);
+    if(!ok) break;
+    population_stats(cur);
+    out->steps++;
+    if(rep->islands != NULL && out->steps%rep->islands->interval == 0) {
+      migrate(rep->islands, rep->r, cur, sat);
+      population_stats(cur);
+    }
+    lower_best(best, cur->umin);
+    update_record(&rec, cur, sat);
+    time += dt;
+  }
+  out->unsat = rec.unsat;
+  free_population(&pop);
+  free_actions(&act);
+  free_staging(&st);
+  free_sweeper(&sw);
+  free(streams);
+  return 1;
+}
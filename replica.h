@@ -0,0 +1,43 @@
+#ifndef REPLICA_H
+#define REPLICA_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "sat.h"
+#include "island.h"
+
+//The settings of one independent run of the diffusion Monte Carlo
+//process. A replica replenishes its population either by teleporting
+//walkers, as in dmcsat, or by sweeping for more samples, as in
+//sweepsat. Replica r draws its random numbers from the streams
+//r<<32 onwards of the seed, so teleporting replica 0 repeats dmcsat
+//and sweeping replica r repeats trial r of sweepsat.
+typedef struct {
+  int sweep;           //replenish by sweeping rather than teleporting
+  int W;               //number of walkers
+  double vscale;       //the scaling of the potential
+  double duration;     //physical duration (hbar = 1)
+  int incremental;     //cache clause counts and flip deltas (teleporting only)
+  uint64_t seed;       //the master seed
+  int r;               //the index of the replica
+  archipelago *islands; //if not NULL, replica r is island r of these
+}replica;
+
+//What a replica found. bs holds WORDS(B) words and must be allocated
+//by the caller.
+typedef struct {
+  weight unsat;        //the lowest unsat found during the run
+  int steps;           //number of timesteps taken
+  int cancelled;       //whether another replica stopped this one
+  uint64_t *bs;        //a bitstring with that unsat
+}outcome;
+
+//Run the replica on the instance. After every timestep the replica
+//lowers *best, the lowest unsat found by any replica, to its own
+//umin, and it stops as soon as *best is zero, so once any replica
+//finds a solution all of them stop within one timestep. Islands also
+//migrate walkers every islands->interval timesteps. Returns 0 if
+//memory could not be allocated.
+int run_replica(replica *rep, instance *sat, atomic_llong *best, outcome *out);
+
+#endif
@@ -0,0 +1,23 @@
+#include <stdint.h>
+#include "rng.h"
+
+//one step of splitmix64, used to expand a seed into generator state
+static uint64_t splitmix64(uint64_t *x) {
+  uint64_t z;
+  *x += 0x9E3779B97F4A7C15LLU;
+  z = *x;
+  z = (z^(z>>30))*0xBF58476D1CE4E5B9LLU;
+  z = (z^(z>>27))*0x94D049BB133111EBLLU;
+  return z^(z>>31);
+}
+
+//initialize r to stream number stream of the master seed
+void rng_seed(rng *r, uint64_t seed, uint64_t stream) {
+  uint64_t x;
+  int i;
+  //mix the stream number in before expanding, so that nearby
+  //(seed, stream) pairs give unrelated states
+  x = seed;
+  x = splitmix64(&x)^stream;
+  for(i = 0; i < 4; i++) r->s[i] = splitmix64(&x);
+}
@@ -0,0 +1,88 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+//This is the random number layer. Every consumer of randomness goes
+//through an rng passed in explicitly, so there is no hidden shared
+//state and each walker can have its own stream. The generator is
+//xoshiro256** (Blackman and Vigna), which passes BigCrush and costs
+//a handful of cycles per 64-bit output. Another generator can be
+//swapped in by changing rng, rng_seed and rng_next.
+
+typedef struct {
+  uint64_t s[4];
+}rng;
+
+//Initialize r to stream number stream of the master seed. Distinct
+//streams are seeded by hashing (seed, stream) with splitmix64, so the
+//numbers a walker sees depend only on its stream number, not on how
+//the work is divided between threads.
+void rng_seed(rng *r, uint64_t seed, uint64_t stream);
+
+static inline uint64_t rng_rotl(uint64_t x, int k) {
+  return (x<<k)|(x>>(64-k));
+}
+
+//return 64 random bits
+static inline uint64_t rng_next(rng *r) {
+  uint64_t result, t;
+  result = rng_rotl(r->s[1]*5, 7)*9;
+  t = r->s[1]<<17;
+  r->s[2] ^= r->s[0];
+  r->s[3] ^= r->s[1];
+  r->s[1] ^= r->s[2];
+  r->s[0] ^= r->s[3];
+  r->s[2] ^= t;
+  r->s[3] = rng_rotl(r->s[3], 45);
+  return result;
+}
+
+//Return a double uniformly distributed in [0,1) with 52 random bits.
+//The bits are placed in the mantissa of a number in [1,2), which is
+//also how the vectorized action sampler does it, so both give the
+//same numbers.
+static inline double rng_uniform(rng *r) {
+  union {
+    uint64_t i;
+    double d;
+  }u;
+  u.i = (rng_next(r)>>12)|0x3FF0000000000000LLU;
+  return u.d-1.0;
+}
+
+//Return a random integer uniformly distributed between 0 and n-1.
+//This is Lemire's multiply-and-shift, which has no modulo bias and
+//only needs a division in the rare case that a rejection is possible.
+static inline int randint(rng *r, int n) {
+  uint64_t m;
+  uint32_t low, threshold;
+  m = (rng_next(r)>>32)*(uint64_t)n;
+  low = (uint32_t)m;
+  if(low < (uint32_t)n) {
+    threshold = (uint32_t)(-(uint32_t)n)%(uint32_t)n;
+    while(low < threshold) {
+      m = (rng_next(r)>>32)*(uint64_t)n;
+      low = (uint32_t)m;
+    }
+  }
+  return (int)(m>>32);
+}
+
+//Bernoulli random variable:
+//return 1 with probability p, 0 with probability 1-p
+static inline int bern(double p, rng *r) {
+  return rng_uniform(r) < p;
+}
+
+//ternary Bernoulli random variable
+//return 0 with probability p0, 1 with probability p1, 2 otherwise 
+static inline int tern(double p0, double p1, rng *r) {
+  double u;
+  u = rng_uniform(r);
+  if(u < p0) return 0;
+  if(u < p0+p1) return 1;
+  return 2;
+}
+
+#endif
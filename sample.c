@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "sample.h"
+#include "telemetry.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SAMPLE_AVX2
+#include <immintrin.h>
+#endif
+
+//allocate the lists for W walkers
+int alloc_actions(actions *act, int W) {
+  act->hops = (int *)malloc(3*W*sizeof(int));
+  if(act->hops == NULL) return 0;
+  act->teleports = act->hops + W;
+  act->sits = act->teleports + W;
+  act->nhop = 0;
+  act->ntel = 0;
+  act->nsit = 0;
+  return 1;
+}
+
+//free the lists allocated by alloc_actions
+void free_actions(actions *act) {
+  free(act->hops);
+}
+
+//Classify walkers w through w1-1 one at a time. The index is written to
+//all three lists and only the count of the chosen one advances, so that
+//there are no unpredictable branches.
+static void sample_scalar(actions *act, population *cur, int w, int w1, weight umin,
+			  double phop, double ptel, rng *streams) {
+  double u;
+  int h, t;
+  for(; w < w1; w++) {
+    u = rng_uniform(&streams[w]);
+    h = u < phop;
+    t = !h && u < phop+ptel*(double)(cur->unsat[w]-umin);
+    act->hops[act->nhop] = w;
+    act->teleports[act->ntel] = w;
+    act->sits[act->nsit] = w;
+    act->nhop += h;
+    act->ntel += t;
+    act->nsit += 1-h-t;
+  }
+}
+
+#ifdef SAMPLE_AVX2
+//rotate each 64-bit lane of x left by k
+#define ROTL256(x, k) _mm256_or_si256(_mm256_slli_epi64((x), (k)), _mm256_srli_epi64((x), 64-(k)))
+
+//Transpose four rows of four 64-bit words. This turns the states of
+//four consecutive rngs into the vectors of their s[0]..s[3] and back.
+__attribute__((target("avx2")))
+static inline void transpose4(__m256i *a, __m256i *b, __m256i *c, __m256i *d) {
+  __m256i t0, t1, t2, t3;
+  t0 = _mm256_unpacklo_epi64(*a, *b);
+  t1 = _mm256_unpackhi_epi64(*a, *b);
+  t2 = _mm256_unpacklo_epi64(*c, *d);
+  t3 = _mm256_unpackhi_epi64(*c, *d);
+  *a = _mm256_permute2x128_si256(t0, t2, 0x20);
+  *b = _mm256_permute2x128_si256(t1, t3, 0x20);
+  *c = _mm256_permute2x128_si256(t0, t2, 0x31);
+  *d = _mm256_permute2x128_si256(t1, t3, 0x31);
+}
+
+//Classify four walkers per iteration: step their four xoshiro256**
+//streams side by side, turn the outputs into doubles in [0,1) exactly
+//as rng_uniform does, and compare them with both thresholds at once.
+//AVX2 cannot convert 64-bit integers to doubles, so the excess energy
+//is converted by placing it in the mantissa of 2^52 and subtracting
+//2^52, which is exact as long as it is below 2^52.
+__attribute__((target("avx2")))
+static void sample_avx2(actions *act, population *cur, weight umin,
+			double phop, double ptel, rng *streams) {
+  __m256i s0, s1, s2, s3, t, x;
+  __m256d u, vhop, vtel, diff, one, two52;
+  __m256i vumin;
+  __m256i *state;
+  int hmask, tmask, smask;
+  int w, k;
+  vhop = _mm256_set1_pd(phop);
+  vtel = _mm256_set1_pd(ptel);
+  one = _mm256_set1_pd(1.0);
+  two52 = _mm256_set1_pd(4503599627370496.0);
+  vumin = _mm256_set1_epi64x(umin);
+  for(w = 0; w+4 <= cur->W; w += 4) {
+    state = (__m256i *)&streams[w];
+    s0 = _mm256_loadu_si256(state);
+    s1 = _mm256_loadu_si256(state+1);
+    s2 = _mm256_loadu_si256(state+2);
+    s3 = _mm256_loadu_si256(state+3);
+    transpose4(&s0, &s1, &s2, &s3);
+    //result = rotl(s1*5, 7)*9
+    x = _mm256_add_epi64(_mm256_slli_epi64(s1, 2), s1);
+    x = ROTL256(x, 7);
+    x = _mm256_add_epi64(_mm256_slli_epi64(x, 3), x);
+    t = _mm256_slli_epi64(s1, 17);
+    s2 = _mm256_xor_si256(s2, s0);
+    s3 = _mm256_xor_si256(s3, s1);
+    s1 = _mm256_xor_si256(s1, s2);
+    s0 = _mm256_xor_si256(s0, s3);
+    s2 = _mm256_xor_si256(s2, t);
+    s3 = ROTL256(s3, 45);
+    transpose4(&s0, &s1, &s2, &s3);
+    _mm256_storeu_si256(state, s0);
+    _mm256_storeu_si256(state+1, s1);
+    _mm256_storeu_si256(state+2, s2);
+    _mm256_storeu_si256(state+3, s3);
+    //the same bit trick as rng_uniform
+    x = _mm256_or_si256(_mm256_srli_epi64(x, 12), _mm256_set1_epi64x(0x3FF0000000000000LL));
+    u = _mm256_sub_pd(_mm256_castsi256_pd(x), one);
+    x = _mm256_sub_epi64(_mm256_loadu_si256((__m256i *)&cur->unsat[w]), vumin);
+    diff = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(x, _mm256_castpd_si256(two52))), two52);
+    hmask = _mm256_movemask_pd(_mm256_cmp_pd(u, vhop, _CMP_LT_OQ));
+    tmask = _mm256_movemask_pd(_mm256_cmp_pd(u, _mm256_add_pd(vhop, _mm256_mul_pd(vtel, diff)), _CMP_LT_OQ));
+    tmask &= ~hmask;
+    smask = ~(hmask|tmask);
+    for(k = 0; k < 4; k++) {
+      act->hops[act->nhop] = w+k;
+      act->teleports[act->ntel] = w+k;
+      act->sits[act->nsit] = w+k;
+      act->nhop += (hmask>>k)&1;
+      act->ntel += (tmask>>k)&1;
+      act->nsit += (smask>>k)&1;
+    }
+  }
+  sample_scalar(act, cur, w, cur->W, umin, phop, ptel, streams);
+}
+#endif
+
+//choose the action of every walker
+void sample_actions(actions *act, population *cur, weight umin, double phop, double ptel, rng *streams) {
+  act->nhop = 0;
+  act->ntel = 0;
+  act->nsit = 0;
+#ifdef SAMPLE_AVX2
+  if(__builtin_cpu_supports("avx2") && cur->umax-umin < ((weight)1<<52)) {
+    sample_avx2(act, cur, umin, phop, ptel, streams);
+    TALLY(sits, act->nsit);
+    return;
+  }
+#endif
+  sample_scalar(act, cur, 0, cur->W, umin, phop, ptel, streams);
+  TALLY(sits, act->nsit);
+}
@@ -0,0 +1,33 @@
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include "population.h"
+#include "rng.h"
+
+//The actions chosen for the population in one timestep, as lists of
+//walker indices in increasing order, so that the hop, teleport and
+//sit handlers can each run as a tight loop over their own list.
+typedef struct {
+  int *hops;           //the walkers that hop
+  int *teleports;      //the walkers that teleport
+  int *sits;           //the walkers that sit
+  int nhop;            //number of hops
+  int ntel;            //number of teleports
+  int nsit;            //number of sits
+}actions;
+
+//allocate the lists for W walkers; returns 0 on failure
+int alloc_actions(actions *act, int W);
+
+//free the lists allocated by alloc_actions
+void free_actions(actions *act);
+
+//Choose the action of every walker. Walker w hops with probability
+//phop, teleports with probability ptel*(cur->unsat[w]-umin) and sits
+//otherwise, using one draw from streams[w]. On x86 machines with AVX2
+//four walkers are handled per instruction; otherwise a scalar loop is
+//used, as it is when the spread of energies reaches 2^52. Both paths
+//make exactly the same choices.
+void sample_actions(actions *act, population *cur, weight umin, double phop, double ptel, rng *streams);
+
+#endif
@@ -1,132 +1,506 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "sat.h"
 #include "bitstrings.h"
 
-//here we load an instance of SAT in the DIMACS file format
-int loadsat(char *filename, instance *sat) {
-  FILE *fp;
-  size_t nbytes;
-  int bytes_read;
-  char *line;
-  char junk1;
-  char junk2[64];
-  int vars, clauses;
-  int i, j, a;
-  int success;
-  int numread;
-  int x[4];
-  nbytes = 255;
-  line = (char *)malloc(256*sizeof(char));
-  fp = fopen(filename, "r");
-  if(fp == NULL) {
+//skip spaces, tabs and line breaks
+static inline char *skip_space(char *p, char *end) {
+  while(p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+  return p;
+}
+
+//skip to the start of the next line
+static inline char *skip_line(char *p, char *end) {
+  while(p < end && *p != '\n') p++;
+  return p < end ? p+1 : p;
+}
+
+//Scan a decimal integer with an optional minus sign into *x, returning
+//the first character after it, or NULL if there is no integer there or
+//it does not fit in an int.
+static inline char *scan_int(char *p, char *end, int *x) {
+  int neg;
+  long v;
+  neg = 0;
+  if(p < end && *p == '-') {
+    neg = 1;
+    p++;
+  }
+  if(p == end || *p < '0' || *p > '9') return NULL;
+  v = 0;
+  while(p < end && *p >= '0' && *p <= '9') {
+    v = 10*v + (*p++ - '0');
+    if(v > 2147483647L) return NULL;
+  }
+  *x = neg ? (int)-v : (int)v;
+  return p;
+}
+
+//report a malformed file, giving the line where p is
+static int parse_error(char *filename, char *base, char *p, char *what) {
+  int line;
+  char *q;
+  line = 1;
+  for(q = base; q < p; q++) line += (*q == '\n');
+  printf("Error: %s on line %i of %s\n", what, line, filename);
+  return 0;
+}
+
+//Scan a positive decimal weight into *x, returning the first character
+//after it, or NULL if there is none there or it does not fit.
+static inline char *scan_weight(char *p, char *end, weight *x) {
+  weight v;
+  if(p == end || *p < '0' || *p > '9') return NULL;
+  v = 0;
+  while(p < end && *p >= '0' && *p <= '9') {
+    if(v > (INT64_MAX - (*p - '0'))/10) return NULL;
+    v = 10*v + (*p++ - '0');
+  }
+  *x = v;
+  return p;
+}
+
+//skip spaces and tabs, but not line breaks
+static inline char *skip_blank(char *p, char *end) {
+  while(p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+  return p;
+}
+
+//The next size of a growing pool of n entries. Clauses and literals
+//are indexed by int, so a pool stops growing at INT_MAX entries.
+static size_t grow(size_t n, size_t extra) {
+  n = 2*n + extra;
+  return n > INT_MAX ? INT_MAX : n;
+}
+
+//Whether a file without a p line is WCNF in the newer format: it is
+//named .wcnf, or some line of it marks a hard clause with h.
+static int headerless_wcnf(char *filename, char *p, char *end) {
+  size_t n;
+  n = strlen(filename);
+  if(n >= 5 && strcmp(filename+n-5, ".wcnf") == 0) return 1;
+  for(; p < end; p = skip_line(p, end)) if(*p == 'h') return 1;
+  return 0;
+}
+
+//Give the hard clauses, marked with weight 0 by parsesat, a weight
+//greater than the total of the soft ones. Returns 0 if the total
+//weight of all the clauses would overflow.
+static int weigh_hard(instance *sat) {
+  weight soft, total;
+  int i;
+  soft = 0;
+  for(i = 0; i < sat->numclauses; i++) {
+    if(sat->weights[i] >= INT64_MAX - soft) return 0;
+    soft += sat->weights[i];
+  }
+  sat->hard = soft+1;
+  total = soft;
+  for(i = 0; i < sat->numclauses; i++) {
+    if(sat->weights[i] > 0) continue;
+    if(sat->hard > INT64_MAX - total) return 0;
+    sat->weights[i] = sat->hard;
+    total += sat->hard;
+  }
+  return 1;
+}
+
+//read the clauses of a DIMACS file in one pass over a private mapping
+int parsesat(char *filename, instance *sat, dimacs *claimed) {
+  int fd;
+  struct stat st;
+  char *base, *p, *q, *end;
+  int x, n, ok, header, inclause, wcnf;
+  size_t cap, litcap;   //room in the clause and literal pools
+  weight top, wt;
+  clause *c, *grown;
+  literal *grownlits;
+  weight *grownweights;
+  fd = open(filename, O_RDONLY);
+  if(fd < 0) {
     printf("Error: unable to open %s\n", filename);
     return 0;
   }
-  success = 0;
-  do {
-    bytes_read = getline(&line, &nbytes, fp);
-    //lines starting with c are comments
-    //lines starting with p specify the parameters
-    //lines with two or fewer bytes are either carriage return or %
-    if(line[0] == 'p') {
-      sscanf(line, "%c %s %i %i", &junk1, junk2, &vars, &clauses);
-      success = 1;
-    }
-  }while(!success && bytes_read > 0);
-  if(!success) {
-    printf("Finished scanning file without finding parameters.\n");
+  if(fstat(fd, &st) != 0 || st.st_size == 0) {
+    printf("Error: %s is empty\n", filename);
+    close(fd);
     return 0;
   }
-  sat->clauses = (clause *)malloc(clauses*sizeof(clause));
-  sat->presence = (contain *)malloc(vars*sizeof(contain));
-  if(sat->clauses == NULL || sat->presence == NULL) {
-    printf("Memory allocation error in loadsat.\n");
+  base = (char *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(base == MAP_FAILED) {
+    printf("Error: unable to map %s\n", filename);
     return 0;
   }
-  sat->B = vars;
-  sat->numclauses = clauses;
-  fseek(fp, 0, SEEK_SET); //return to beginning
-  i = 0;
-  do {
-    bytes_read = getline(&line, &nbytes, fp);    
-    if(line[0] != 'c' && line[0] != 'p' && bytes_read > 2) {
-      numread = sscanf(line, "%i %i %i %i", &x[0], &x[1], &x[2], &x[3]);
-      if(x[numread-1] != 0) printf("Warning: line %s not terminated with 0.\n", line);
-      sat->clauses[i].numvars = numread-1;
-      for(j = 0; j < numread-1; j++) {
-        sat->clauses[i].vars[j] = abs(x[j])-1;
-        sat->clauses[i].nots[j] = 0;
-        if(x[j] < 0) sat->clauses[i].nots[j] = 1;
+  madvise(base, st.st_size, MADV_SEQUENTIAL);
+  end = base + st.st_size;
+  sat->clauses = NULL;
+  sat->numclauses = 0;
+  sat->lits = NULL;
+  sat->numlits = 0;
+  sat->weights = NULL;
+  sat->B = 0;
+  header = 0;
+  wcnf = 0;             //whether each clause starts with a weight
+  top = INT64_MAX;      //the weight from which a clause is hard
+  cap = 0;
+  litcap = 0;
+  n = 0;                //literals in the clause being read
+  inclause = 0;         //whether a clause is being read
+  c = NULL;
+  ok = 1;
+  p = skip_space(base, end);
+  while(ok && p < end) {
+    if(*p == 'c') p = skip_line(p, end);
+    //SATLIB files end with a line holding just %
+    else if(*p == '%') break;
+    else if(*p == 'p') {
+      q = skip_space(p+1, end);
+      if(end-q >= 4 && q[0] == 'w' && q[1] == 'c' && q[2] == 'n' && q[3] == 'f') {
+	wcnf = 1;
+	q++;
       }
-      for(j = 0; j < 4; j++) {
-        sat->clauses[i].bitmask[j] = 0;
-        sat->clauses[i].notmask[j] = 0;
+      if(header || sat->numclauses > 0 || inclause || end-q < 3 || q[0] != 'c' || q[1] != 'n' || q[2] != 'f'
+	 || (q = scan_int(skip_space(q+3, end), end, &claimed->vars)) == NULL
+	 || (q = scan_int(skip_space(q, end), end, &claimed->clauses)) == NULL
+	 || claimed->vars < 0 || claimed->clauses < 0) {
+	ok = parse_error(filename, base, p, "malformed or repeated p line");
+	break;
       }
-      for(j = 0; j < sat->clauses[i].numvars; j++) {
-        flip(sat->clauses[i].bitmask, sat->clauses[i].vars[j], 256);
-        if(sat->clauses[i].nots[j]) flip(sat->clauses[i].notmask, sat->clauses[i].vars[j], 256);
+      //the top weight is optional, and only on the p line itself
+      if(wcnf && (p = skip_blank(q, end)) < end && *p != '\n') {
+	if((q = scan_weight(p, end, &top)) == NULL || top == 0) {
+	  ok = parse_error(filename, base, p, "malformed top weight");
+	  break;
+	}
+      }
+      p = q;
+      header = 1;
+      sat->B = claimed->vars;
+      cap = claimed->clauses;
+      litcap = cap > INT_MAX/3 ? INT_MAX : 3*cap;
+      sat->clauses = (clause *)malloc((cap > 0 ? cap : 1)*sizeof(clause));
+      sat->lits = (literal *)malloc((litcap > 0 ? litcap : 1)*sizeof(literal));
+      if(wcnf) sat->weights = (weight *)malloc((cap > 0 ? cap : 1)*sizeof(weight));
+      if(sat->clauses == NULL || sat->lits == NULL || (wcnf && sat->weights == NULL)) {
+	printf("Memory allocation error in parsesat.\n");
+	ok = 0;
       }
-      i++;
     }
-  }while(bytes_read > 0);
-  //fill in contain--------------------------------------------------------
-  for(i = 0; i < sat->B; i++) {
-    sat->presence[i].list = (int *)malloc(sat->numclauses*sizeof(int));
-    sat->presence[i].num = 0;
+    else {
+      //without a p line, the file must be a WCNF file in the newer format
+      if(!header && !wcnf) {
+	if(!headerless_wcnf(filename, p, end)) {
+	  ok = parse_error(filename, base, p, "clause before the p line");
+	  break;
+	}
+	wcnf = 1;
+	sat->B = 0;
+      }
+      //a clause may span lines and a line may hold several clauses
+      if(!inclause) {
+	if((size_t)sat->numclauses == cap) {
+	  if(cap == INT_MAX) {
+	    ok = parse_error(filename, base, p, "more clauses than fit in an int");
+	    break;
+	  }
+	  cap = grow(cap, 1024);
+	  grown = (clause *)realloc(sat->clauses, cap*sizeof(clause));
+	  if(grown != NULL) sat->clauses = grown;
+	  grownweights = sat->weights;
+	  if(wcnf) {
+	    grownweights = (weight *)realloc(sat->weights, cap*sizeof(weight));
+	    if(grownweights != NULL) sat->weights = grownweights;
+	  }
+	  if(grown == NULL || grownweights == NULL) {
+	    printf("Memory allocation error in parsesat.\n");
+	    ok = 0;
+	    break;
+	  }
+	}
+	c = &(sat->clauses[sat->numclauses]);
+	c->first = sat->numlits;
+	inclause = 1;
+	//a weighted clause starts with its weight, or h if it is hard, which is marked with 0 for now
+	if(wcnf) {
+	  if(!header && *p == 'h') {
+	    q = p+1;
+	    wt = 0;
+	  }
+	  else if((q = scan_weight(p, end, &wt)) == NULL || wt == 0) {
+	    ok = parse_error(filename, base, p, "malformed clause weight");
+	    break;
+	  }
+	  sat->weights[sat->numclauses] = wt >= top ? 0 : wt;
+	  p = skip_space(q, end);
+	  continue;
+	}
+      }
+      if((q = scan_int(p, end, &x)) == NULL) {
+	ok = parse_error(filename, base, p, "unexpected character");
+	break;
+      }
+      p = q;
+      if(x == 0) {
+	c->numvars = n;
+	sat->numclauses++;
+	n = 0;
+	inclause = 0;
+      }
+      else if(header && (x > sat->B || -x > sat->B)) ok = parse_error(filename, base, p, "variable out of the declared range");
+      else {
+	if((size_t)sat->numlits == litcap) {
+	  if(litcap == INT_MAX) {
+	    ok = parse_error(filename, base, p, "more literals than fit in an int");
+	    break;
+	  }
+	  litcap = grow(litcap, 4096);
+	  grownlits = (literal *)realloc(sat->lits, litcap*sizeof(literal));
+	  if(grownlits == NULL) {
+	    printf("Memory allocation error in parsesat.\n");
+	    ok = 0;
+	    break;
+	  }
+	  sat->lits = grownlits;
+	}
+	sat->lits[sat->numlits++] = LIT((x < 0 ? -x : x)-1, x < 0);
+	if(!header && (x < 0 ? -x : x) > sat->B) sat->B = x < 0 ? -x : x;
+	n++;
+      }
+    }
+    p = skip_space(p, end);
+  }
+  if(ok && !header && !wcnf) {
+    printf("Finished scanning file without finding parameters.\n");
+    ok = 0;
   }
-  for(i = 0; i < clauses; i++) {
+  //a last clause without its 0 still counts
+  if(ok && inclause) {
+    printf("Warning: the last clause of %s is not terminated with 0.\n", filename);
+    c->numvars = n;
+    sat->numclauses++;
+  }
+  if(ok && !header) {
+    claimed->vars = sat->B;
+    claimed->clauses = sat->numclauses;
+  }
+  if(ok && wcnf && !weigh_hard(sat)) {
+    printf("Error: the weights of %s are too large\n", filename);
+    ok = 0;
+  }
+  munmap(base, st.st_size);
+  if(!ok) {
+    free(sat->clauses);
+    free(sat->lits);
+    free(sat->weights);
+  }
+  return ok;
+}
+
+//here we load an instance of SAT in the DIMACS file format
+int loadsat(char *filename, instance *sat) {
+  dimacs claimed;
+  if(!parsesat(filename, sat, &claimed)) return 0;
+  if(sat->numclauses != claimed.clauses)
+    printf("Warning: %i clauses claimed, %i clauses counted\n", claimed.clauses, sat->numclauses);
+  return compilesat(sat);
+}
+
+//Merge repeated literals and drop clauses holding both signs of a
+//variable, in place, then sort the clauses stably by length into new
+//arrays, taking their weights along. Returns 0 if out of memory.
+static int sortclauses(instance *sat) {
+  unsigned int *seen;   //2*(c+1)+sign for the last clause c a variable was seen in
+  int *count;           //the first sorted position of each length
+  int *next;            //the next free literal of each length
+  clause *sorted;
+  literal *lits;
+  weight *weights;
+  literal l;
+  int i, j, n, w, first, len, kept, maxlen, taut;
+  seen = (unsigned int *)calloc(sat->B > 0 ? sat->B : 1, sizeof(unsigned int));
+  if(seen == NULL) return 0;
+  //nothing is written past what has been read, since clauses only shrink
+  w = 0;
+  kept = 0;
+  maxlen = 0;
+  for(i = 0; i < sat->numclauses; i++) {
+    first = sat->clauses[i].first;
+    len = sat->clauses[i].numvars;
+    n = 0;
+    taut = 0;
+    for(j = 0; j < len; j++) {
+      l = sat->lits[first+j];
+      //unsigned, since 2*(c+1) passes INT_MAX past a billion clauses
+      if(seen[LITVAR(l)]>>1 != (unsigned int)i+1) {
+	seen[LITVAR(l)] = 2*((unsigned int)i+1)+LITNOT(l);
+	sat->lits[w+n++] = l;
+      }
+      else if((int)(seen[LITVAR(l)]&1) != LITNOT(l)) taut = 1;
+    }
+    if(taut) continue;
+    sat->clauses[kept].first = w;
+    sat->clauses[kept].numvars = n;
+    if(sat->weights != NULL) sat->weights[kept] = sat->weights[i];
+    kept++;
+    w += n;
+    if(n > maxlen) maxlen = n;
+  }
+  free(seen);
+  sat->numclauses = kept;
+  sat->numlits = w;
+  count = (int *)calloc(maxlen+2, sizeof(int));
+  next = (int *)calloc(maxlen+1, sizeof(int));
+  sorted = (clause *)malloc((kept > 0 ? kept : 1)*sizeof(clause));
+  lits = (literal *)malloc((w > 0 ? w : 1)*sizeof(literal));
+  weights = NULL;
+  if(sat->weights != NULL) weights = (weight *)malloc((kept > 0 ? kept : 1)*sizeof(weight));
+  if(count == NULL || next == NULL || sorted == NULL || lits == NULL || (sat->weights != NULL && weights == NULL)) {
+    free(count);
+    free(next);
+    free(sorted);
+    free(lits);
+    free(weights);
+    return 0;
+  }
+  for(i = 0; i < kept; i++) count[sat->clauses[i].numvars+1]++;
+  //count[len+1] is the number of clauses of length len until the prefix sum
+  for(len = 1; len <= maxlen; len++) next[len] = next[len-1] + (len-1)*count[len];
+  for(len = 1; len <= maxlen+1; len++) count[len] += count[len-1];
+  for(i = 0; i < kept; i++) {
+    len = sat->clauses[i].numvars;
+    sorted[count[len]].first = next[len];
+    sorted[count[len]].numvars = len;
+    if(weights != NULL) weights[count[len]] = sat->weights[i];
+    for(j = 0; j < len; j++) lits[next[len]+j] = sat->lits[sat->clauses[i].first+j];
+    count[len]++;
+    next[len] += len;
+  }
+  free(count);
+  free(next);
+  free(sat->clauses);
+  free(sat->lits);
+  free(sat->weights);
+  sat->clauses = sorted;
+  sat->lits = lits;
+  sat->weights = weights;
+  return 1;
+}
+
+//sort the clauses by length and build the occurrence index and, for
+//instances of up to DENSE_MAX bits, the dense clause masks
+int compilesat(instance *sat) {
+  int i, j, a;
+  literal l;
+  uint64_t *mask;
+  sat->mapping = NULL;
+  sat->mapsize = 0;
+  sat->start = NULL;
+  sat->occurs = NULL;
+  sat->masks = NULL;
+  if(!sortclauses(sat)) {
+    printf("Memory allocation error in compilesat.\n");
+    return 0;
+  }
+  //an unweighted instance is one with every clause soft and of weight 1
+  if(sat->weights == NULL) sat->hard = (weight)sat->numclauses+1;
+  sat->total = 0;
+  for(i = 0; i < sat->numclauses; i++) sat->total += WEIGHT(sat, i);
+  sat->start = (int *)calloc(sat->B+1, sizeof(int));
+  if(sat->start == NULL) {
+    printf("Memory allocation error in compilesat.\n");
+    return 0;
+  }
+  //fill in the occurrences------------------------------------------------
+  //Count them into start[v+1], so that the prefix sum leaves start[v]
+  //at the first occurrence of v. Shifting that up by one makes start[v+1]
+  //the fill position of v, and it ends up at the first occurrence of v+1.
+  for(i = 0; i < sat->numclauses; i++)
+    for(j = 0; j < sat->clauses[i].numvars; j++) sat->start[LITVAR(sat->lits[sat->clauses[i].first+j])+1]++;
+  for(i = 1; i <= sat->B; i++) sat->start[i] += sat->start[i-1];
+  sat->occurs = (occurrence *)malloc((sat->start[sat->B] > 0 ? sat->start[sat->B] : 1)*sizeof(occurrence));
+  if(sat->occurs == NULL) {
+    printf("Memory allocation error in compilesat.\n");
+    return 0;
+  }
+  for(i = sat->B; i > 0; i--) sat->start[i] = sat->start[i-1];
+  for(i = 0; i < sat->numclauses; i++) {
     for(j = 0; j < sat->clauses[i].numvars; j++) {
-      a = sat->clauses[i].vars[j];
-      sat->presence[a].list[sat->presence[a].num] = i;
-      sat->presence[a].num++;
+      l = sat->lits[sat->clauses[i].first+j];
+      sat->occurs[sat->start[LITVAR(l)+1]++] = OCC(i, LITNOT(l));
     }
-  }    
+  }
+  //fill in the dense masks------------------------------------------------
+  sat->words = DENSE_WORDS(sat->B);
+  if(sat->words > 0) {
+    sat->masks = (uint64_t *)calloc((size_t)2*sat->words*sat->numclauses, sizeof(uint64_t));
+    if(sat->masks == NULL) {
+      printf("Memory allocation error in compilesat.\n");
+      return 0;
+    }
+    for(i = 0; i < sat->numclauses; i++) {
+      mask = sat->masks + (size_t)2*sat->words*i;
+      for(j = 0; j < sat->clauses[i].numvars; j++) {
+        a = LITVAR(sat->lits[sat->clauses[i].first+j]);
+        mask[a>>6] |= 1LLU<<(a&63);
+        if(LITNOT(sat->lits[sat->clauses[i].first+j])) mask[sat->words+(a>>6)] |= 1LLU<<(a&63);
+      }
+    }
+  }
   //-----------------------------------------------------------------------
-  fclose(fp);
-  free(line);
   return 1;
 }
 
-//print the 3SAT instance to stdout
+//print the instance to stdout
 void printsat(instance *sat) {
   int i,j;
   printf("%i variables, %i clauses\n", sat->B, sat->numclauses);
   for(i = 0; i < sat->numclauses; i++) {
+    if(sat->weights != NULL) printf("[%lli] ", (long long)sat->weights[i]);
     for(j = 0; j < sat->clauses[i].numvars; j++) {
-      if(sat->clauses[i].nots[j]) printf("!");
-      printf("%i ", sat->clauses[i].vars[j]);
+      if(LITNOT(sat->lits[sat->clauses[i].first+j])) printf("!");
+      printf("%i ", LITVAR(sat->lits[sat->clauses[i].first+j]));
     }
     printf("\n");
-    print_bits(sat->clauses[i].bitmask, 256);
-    print_bits(sat->clauses[i].notmask, 256);
   }
   for(i = 0; i < sat->B; i++) {
-    printf("variable %i is present in %i clauses: ", i, sat->presence[i].num);
-    for(j = 0; j < sat->presence[i].num; j++) printf("%i ", sat->presence[i].list[j]);
+    printf("variable %i is present in %i clauses: ", i, sat->start[i+1]-sat->start[i]);
+    for(j = sat->start[i]; j < sat->start[i+1]; j++) printf("%s%i ", OCCNOT(sat->occurs[j]) ? "!" : "", OCCCLAUSE(sat->occurs[j]));
     printf("\n");
   }
 }
 
-//deallocate the memory allocated by loadsat
+//deallocate the memory allocated by loadsat or cachesat
 void freesat(instance *sat) {
-  int i;
+  //everything in a cached instance is in the mapping
+  if(sat->mapping != NULL) {
+    munmap(sat->mapping, sat->mapsize);
+    return;
+  }
   free(sat->clauses);
-  for(i = 0; i < sat->B; i++) free(sat->presence[i].list);
-  free(sat->presence);
-}
-
-//This function is the workhorse of the algorithm, so it is
-//optimized for performance at the expense of readability, as
-//one can readily see.
-int violated(uint64_t *bs, clause *c) {
-  uint64_t w[6];
-  w[0] = (c->bitmask[0]&bs[0])^c->notmask[0];
-  w[1] = (c->bitmask[1]&bs[1])^c->notmask[1];
-  w[2] = (c->bitmask[2]&bs[2])^c->notmask[2];
-  w[3] = (c->bitmask[3]&bs[3])^c->notmask[3];
-  w[4] = w[0]|w[1];
-  w[5] = w[2]|w[3];
-  if(w[4]|w[5]) return 0;
-  return 1;
+  free(sat->lits);
+  free(sat->start);
+  free(sat->occurs);
+  free(sat->masks);
+  free(sat->weights);
+}
+
+//print the result of a weighted instance in the MaxSAT evaluation format
+void print_maxsat(instance *sat, uint64_t *bs, weight u) {
+  int i;
+  if(u >= sat->hard) {
+    printf("s UNKNOWN\n");
+    return;
+  }
+  printf("o %lli\n", (long long)u);
+  printf("s %s\n", u == 0 ? "OPTIMUM FOUND" : "SATISFIABLE");
+  printf("v ");
+  for(i = 0; i < sat->B; i++) putchar('0' + (int)((bs[i>>6]>>(i&63))&1));
+  printf("\n");
 }
@@ -5,39 +5,176 @@
 #include <malloc.h>
 #include <stdint.h>
 
-//I have made these arrays of size four, which limits us
-//to a maximum of 256 bits. This is a tradeoff between
-//generality and performance.
+//A literal packs the variable index and its polarity into 32 bits:
+//the index is shifted up by one and the low bit is 1 if notted.
+//This keeps a literal at 4 bytes regardless of the number of bits.
+typedef uint32_t literal;
+
+#define LIT(var, not) (((literal)(var)<<1)|(literal)(not))
+#define LITVAR(l) ((int)((l)>>1))
+#define LITNOT(l) ((int)((l)&1))
+
+//A clause is the run of numvars literals starting at sat->lits[first].
+//Clauses may have any length. compilesat sorts them by length, so
+//that the clauses of each length are contiguous and evenly spaced in
+//sat->lits, and the kernels below branch on the length predictably.
 typedef struct {
-  uint64_t bitmask[4];
-  uint64_t notmask[4];
-  int vars[3];         //the indices of the variables
-  int nots[3];         //1 = notted, 0 = not notted
-  int numvars;         //currently maximum is three
+  int first;           //index of its first literal in sat->lits
+  int numvars;         //how many literals it has
 }clause;
 
-typedef struct {
-  int num;    //number of clauses that contain this variable
-  int *list;  //a list of the clause numbers that contain this variable
-}contain;
+//An occurrence packs the number of a clause containing a variable
+//with the sign of the variable's literal in it, the same way a literal
+//does, so that the sign is known without loading the clause.
+typedef uint32_t occurrence;
+
+#define OCC(clause, not) (((occurrence)(clause)<<1)|(occurrence)(not))
+#define OCCCLAUSE(o) ((int)((o)>>1))
+#define OCCNOT(o) ((int)((o)&1))
 
+//The weight of a clause in a weighted (WCNF) instance. The potential
+//of a bitstring is the total weight of the clauses it violates, so it
+//stays an integer however the weights are chosen.
+typedef int64_t weight;
+
+//For instances of up to DENSE_MAX bits, each clause also gets a
+//bitmask and a notmask of sat->words words (stored back to back in
+//masks), so that violated_dense can test it with a few word operations.
 typedef struct {
   clause *clauses;   //the clauses
+  literal *lits;     //their literals, back to back
+  int numlits;       //how many literals there are
   int numclauses;    //how many clauses there are
   int B;             //how many bits there are
-  contain *presence; //which variables are present in which clauses
+  int *start;        //the occurrences of variable v are occurs[start[v]] to occurs[start[v+1]-1]
+  occurrence *occurs; //the occurrences of every variable, back to back
+  int words;         //width of the dense kernels (1, 2, 4 or 8), 0 if sparse
+  uint64_t *masks;   //dense masks, 2*words per clause, NULL if sparse
+  weight *weights;   //the weight of each clause, NULL if every weight is 1
+  weight hard;       //the weight of a hard clause, more than all soft ones together
+  weight total;      //the weight of all the clauses
+  void *mapping;     //the cache the instance was mapped from, NULL if allocated
+  size_t mapsize;    //its size
 }instance;
 
-//here we load an instance of 3SAT in the DIMACS file format
+//the weight of clause c
+#define WEIGHT(sat, c) ((sat)->weights != NULL ? (sat)->weights[c] : (weight)1)
+
+//what the p line of a DIMACS file claims
+typedef struct {
+  int vars;            //number of variables
+  int clauses;         //number of clauses
+}dimacs;
+
+//Read the clauses of a DIMACS file into sat, in a single pass over a
+//memory mapping of the file, without building the occurrence index or
+//masks. Comments may appear anywhere, a clause may span several lines
+//and a line may hold several clauses. sat->B is the claimed number of
+//variables, which no literal may exceed, and sat->numclauses the
+//number actually read. The clauses are in the order of the file, and
+//may repeat literals. Clauses and literals are indexed by int, so a
+//file with more of either than INT_MAX is refused. Returns 0 if the
+//file is malformed.
+//
+//Weighted MaxSAT files are read too, either with a "p wcnf V C top"
+//line, where each clause starts with its weight and a weight of top or
+//more makes it hard, or in the newer format without a p line, where
+//each clause starts with its weight or with h for a hard one and B is
+//the largest variable. A file is only taken to be in the newer format
+//if it is named .wcnf or has a hard clause; otherwise a missing p line
+//is an error. Hard clauses get the weight sat->hard, one more
+//than the total soft weight, so that violating one always costs more
+//than violating every soft clause. A plain CNF file leaves
+//sat->weights NULL.
+int parsesat(char *filename, instance *sat, dimacs *claimed);
+
+//here we load an instance of SAT in the DIMACS file format
 int loadsat(char *filename, instance *sat);
 
-//print the 3SAT instance to stdout
+//Once the clauses are filled in, merge repeated literals, drop
+//clauses that hold both signs of a variable (they are always
+//satisfied), sort the clauses by length and build the occurrence index
+//and dense masks.
+int compilesat(instance *sat);
+
+//print the instance to stdout
 void printsat(instance *sat);
 
-//deallocate the memory allocated by loadsat
+//Print the result of a weighted instance in the output format of the
+//MaxSAT evaluations, given the best bitstring bs found and its
+//potential u. If bs satisfies every hard clause that is its cost as an
+//o line, an s line saying whether it is optimal (u is 0) and bs as a v
+//line of 0s and 1s; otherwise just "s UNKNOWN".
+void print_maxsat(instance *sat, uint64_t *bs, weight u);
+
+//deallocate the memory allocated by loadsat or cachesat
 void freesat(instance *sat);
 
-//return 1 if the clause is violated, 0 otherwise
-int violated(uint64_t *bs, clause *c);
+//whether literal l is true in bs
+#define LITTRUE(bs, l) ((int)(((bs)[(l)>>7]>>(((l)>>1)&63))^(l))&1)
+
+//The number of true literals among the k at l. k is a compile-time
+//constant in the kernels below, so the loop unrolls without branches.
+static inline int count_true(uint64_t *bs, literal *l, const int k) {
+  int j, n;
+  n = 0;
+  for(j = 0; j < k; j++) n += LITTRUE(bs, l[j]);
+  return n;
+}
+
+//The number of true literals in clause c, using the kernel specialized
+//for its length. Only the literals are examined, so the cost does not
+//depend on the number of bits.
+static inline int numtrue(uint64_t *bs, instance *sat, int c) {
+  literal *l;
+  l = sat->lits + sat->clauses[c].first;
+  switch(sat->clauses[c].numvars) {
+  case 2: return count_true(bs, l, 2);
+  case 3: return count_true(bs, l, 3);
+  case 4: return count_true(bs, l, 4);
+  case 5: return count_true(bs, l, 5);
+  default: return count_true(bs, l, sat->clauses[c].numvars);
+  }
+}
+
+//This function is the workhorse of the algorithm. It returns 1 if
+//clause c is violated, 0 otherwise. Short clauses use the kernel
+//specialized for their length, and long ones stop at the first true
+//literal.
+static inline int violated(uint64_t *bs, instance *sat, int c) {
+  literal *l;
+  int j;
+  l = sat->lits + sat->clauses[c].first;
+  switch(sat->clauses[c].numvars) {
+  case 2: return count_true(bs, l, 2) == 0;
+  case 3: return count_true(bs, l, 3) == 0;
+  case 4: return count_true(bs, l, 4) == 0;
+  case 5: return count_true(bs, l, 5) == 0;
+  default:
+    for(j = 0; j < sat->clauses[c].numvars; j++) if(LITTRUE(bs, l[j])) return 0;
+    return 1;
+  }
+}
+
+//the weight of the clauses of bs that are violated
+static inline weight potential(uint64_t *bs, instance *sat) {
+  weight u;
+  int c;
+  u = 0;
+  for(c = 0; c < sat->numclauses; c++) u += violated(bs, sat, c)*WEIGHT(sat, c);
+  return u;
+}
+
+//The dense version of violated for clause number c. The width nw should
+//be a compile-time constant at the call site so that the loop unrolls.
+static inline int violated_dense(uint64_t *bs, instance *sat, int c, const int nw) {
+  uint64_t *m;
+  uint64_t w;
+  int i;
+  m = sat->masks + (size_t)2*nw*c;
+  w = 0;
+  for(i = 0; i < nw; i++) w |= (m[i]&bs[i])^m[nw+i];
+  return w == 0;
+}
 
 #endif
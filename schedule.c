@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "schedule.h"
+
+//read the points of a piecewise schedule, separated by commas
+static int parse_knots(schedule *sc, char *list) {
+  char *end;
+  double u, s;
+  sc->knots = 0;
+  while(*list != '\0') {
+    if(sc->knots == MAXKNOTS) return 0;
+    u = strtod(list, &end);
+    if(end == list || *end != '/') return 0;
+    list = end+1;
+    s = strtod(list, &end);
+    if(end == list || (*end != ',' && *end != '\0')) return 0;
+    list = *end == ',' ? end+1 : end;
+    //the points must stay inside the unit square and s must not fall
+    if(u <= 0 || u >= 1 || s < 0 || s > 1) return 0;
+    if(sc->knots > 0 && (u <= sc->u[sc->knots-1] || s < sc->s[sc->knots-1])) return 0;
+    sc->u[sc->knots] = u;
+    sc->s[sc->knots] = s;
+    sc->knots++;
+  }
+  return sc->knots > 0;
+}
+
+//read a schedule from its description
+int parse_schedule(schedule *sc, char *spec) {
+  char *end;
+  sc->shape = SHAPE_LINEAR;
+  sc->exponent = 1;
+  sc->knots = 0;
+  sc->slowdown = 0;
+  if(strcmp(spec, "linear") == 0) return 1;
+  if(strncmp(spec, "power:", 6) == 0) {
+    sc->shape = SHAPE_POWER;
+    sc->exponent = strtod(spec+6, &end);
+    return end != spec+6 && *end == '\0' && sc->exponent > 0;
+  }
+  if(strncmp(spec, "piecewise:", 10) == 0) {
+    sc->shape = SHAPE_PIECEWISE;
+    return parse_knots(sc, spec+10);
+  }
+  if(strncmp(spec, "adaptive:", 9) == 0) {
+    sc->slowdown = strtod(spec+9, &end);
+    return end != spec+9 && *end == '\0' && sc->slowdown >= 1;
+  }
+  return 0;
+}
+
+//read a restart policy from its description
+int parse_restarts(restarts *rs, char *spec) {
+  char *end;
+  rs->factor = 1;
+  if(strcmp(spec, "fixed") == 0) {
+    rs->kind = RESTART_FIXED;
+    return 1;
+  }
+  if(strcmp(spec, "luby") == 0) {
+    rs->kind = RESTART_LUBY;
+    return 1;
+  }
+  if(strncmp(spec, "geometric:", 10) == 0) {
+    rs->kind = RESTART_GEOMETRIC;
+    rs->factor = strtod(spec+10, &end);
+    return end != spec+10 && *end == '\0' && rs->factor > 0;
+  }
+  return 0;
+}
+
+//start a run
+void start_schedule(schedule *sc, double duration) {
+  sc->duration = duration;
+  sc->time = 0;
+  sc->progress = 0;
+}
+
+//the current value of s
+double schedule_s(schedule *sc) {
+  double u, u0, s0, u1, s1;
+  int i;
+  u = sc->progress;
+  if(sc->shape == SHAPE_POWER) return pow(u, sc->exponent);
+  if(sc->shape == SHAPE_PIECEWISE) {
+    u0 = 0;
+    s0 = 0;
+    for(i = 0; i < sc->knots && sc->u[i] <= u; i++) {
+      u0 = sc->u[i];
+      s0 = sc->s[i];
+    }
+    u1 = i < sc->knots ? sc->u[i] : 1.0;
+    s1 = i < sc->knots ? sc->s[i] : 1.0;
+    return s0 + (s1-s0)*(u-u0)/(u1-u0);
+  }
+  return u;
+}
+
+//advance the run by dt
+void advance_schedule(schedule *sc, double dt, double spread) {
+  double rate;
+  sc->time += dt;
+  //without slowdown the progress is exactly time/duration, as it always was
+  if(sc->slowdown == 0) {
+    sc->progress = sc->time/sc->duration;
+    return;
+  }
+  //A collapsed spread means the population has lost its diversity and
+  //the teleports have little left to select between, so hold s back
+  //and let the hops spread the walkers out again.
+  rate = spread >= sc->slowdown ? 1.0 : (spread > 1 ? spread : 1)/sc->slowdown;
+  sc->progress += rate*dt/sc->duration;
+}
+
+//whether the run is over
+int schedule_done(schedule *sc) {
+  if(sc->slowdown == 0) return sc->time >= sc->duration;
+  return sc->progress >= 1.0;
+}
+
+//the i-th term, from 0, of the Luby sequence 1,1,2,1,1,2,4,1,1,2,...
+static double luby(int i) {
+  int size, seq;
+  //find the finite subsequence that contains index i, and its size
+  for(size = 1, seq = 0; size < i+1; seq++, size = 2*size+1);
+  while(size-1 != i) {
+    size = (size-1)>>1;
+    seq--;
+    i = i%size;
+  }
+  return pow(2.0, seq);
+}
+
+//the duration of run i
+double restart_duration(restarts *rs, int i, double base) {
+  if(rs->kind == RESTART_LUBY) return base*luby(i);
+  if(rs->kind == RESTART_GEOMETRIC) return base*pow(rs->factor, i);
+  return base;
+}
@@ -0,0 +1,73 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+//The annealing schedule says how s rises from 0 to 1 over a run, and
+//the restart policy says how long each of a sequence of independent
+//runs lasts. A schedule is written on the command line as
+//  linear                  s rises at a constant rate
+//  power:p                 s = u^p, where u is the fraction of the run done
+//  piecewise:u/s,u/s,...   s is interpolated between the given points,
+//                          with (0,0) and (1,1) implied
+//  adaptive:k              linear, but u advances up to k times more
+//                          slowly while umax-umin is below k
+//and a restart policy as
+//  fixed                   every run lasts the base duration
+//  luby                    run i lasts luby(i) times the base duration,
+//                          i.e. 1,1,2,1,1,2,4,1,1,2,...
+//  geometric:g             run i lasts g^i times the base duration
+
+//the most points of a piecewise schedule
+#define MAXKNOTS 16
+
+//the shapes of s
+#define SHAPE_LINEAR 0
+#define SHAPE_POWER 1
+#define SHAPE_PIECEWISE 2
+
+//the restart policies
+#define RESTART_FIXED 0
+#define RESTART_LUBY 1
+#define RESTART_GEOMETRIC 2
+
+//an annealing schedule and where a run is along it
+typedef struct {
+  int shape;           //one of the SHAPE constants
+  double exponent;     //of a power schedule
+  int knots;           //points of a piecewise schedule
+  double u[MAXKNOTS];  //their fractions of the run, increasing
+  double s[MAXKNOTS];  //their values of s, nondecreasing
+  double slowdown;     //the k of an adaptive schedule, or 0
+  double duration;     //physical duration of the run (hbar = 1)
+  double time;         //physical time elapsed
+  double progress;     //the fraction u of the run done
+}schedule;
+
+//a restart policy
+typedef struct {
+  int kind;            //one of the RESTART constants
+  double factor;       //the growth of a geometric policy
+}restarts;
+
+//Read a schedule from its description. Returns 0 if it is malformed.
+int parse_schedule(schedule *sc, char *spec);
+
+//Read a restart policy from its description. Returns 0 if it is malformed.
+int parse_restarts(restarts *rs, char *spec);
+
+//start a run of the given duration at s = 0
+void start_schedule(schedule *sc, double duration);
+
+//the current value of s
+double schedule_s(schedule *sc);
+
+//Advance the run by the timestep dt, taken while the population spanned
+//spread = umax-umin unsatisfied clauses, or that much weight of them.
+void advance_schedule(schedule *sc, double dt, double spread);
+
+//whether the run is over
+int schedule_done(schedule *sc);
+
+//the duration of run i (from 0) of a policy with the given base duration
+double restart_duration(restarts *rs, int i, double base);
+
+#endif
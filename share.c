@@ -0,0 +1,308 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "bitstrings.h"
+#include "share.h"
+#include "walk.h"
+#include "generate.h"
+
+//how long to wait for the first process to record its pid in a new
+//segment, in milliseconds
+#define SHARE_TIMEOUT 10000
+
+//round n up to a multiple of a
+static size_t roundup(size_t n, size_t a) {
+  return (n+a-1)/a*a;
+}
+
+//slot i of the elite ring
+static elite *slot(shared *sh, int i) {
+  segment *seg;
+  seg = (segment *)sh->base;
+  return (elite *)(sh->base + seg->ring + (size_t)i*seg->slotsize);
+}
+
+//write the instance into a new segment of fd
+static int create_segment(shared *sh, int fd, char *filename) {
+  instance local;
+  segment layout;
+  segment *seg;
+  size_t page, head, total;
+  fileid id;
+  //size the header and record our pid before parsing, which can take
+  //a while, so that the other processes know whom they are waiting for
+  page = sysconf(_SC_PAGESIZE);
+  head = roundup(sizeof(segment), page);
+  if(ftruncate(fd, head) != 0) return 0;
+  seg = (segment *)mmap(NULL, head, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  if(seg == MAP_FAILED) return 0;
+  atomic_store(&seg->creator, sh->owner);
+  munmap(seg, head);
+  //identify before parsing, so that a file changed in between leaves a mismatch rather than a wrong instance
+  if(!identify(filename, &id) || !opensat(filename, &local)) return 0;
+  total = local.start[local.B];
+  //the instance starts on its own page so that it can be made read-only
+  layout.numclauses = local.numclauses;
+  layout.B = local.B;
+  layout.words = local.words;
+  layout.stride = local.words > 0 ? local.words : WORDS(local.B);
+  layout.clauses = head;
+  layout.numlits = local.numlits;
+  layout.lits = layout.clauses + (size_t)local.numclauses*sizeof(clause);
+  layout.start = roundup(layout.lits + (size_t)local.numlits*sizeof(literal), 8);
+  layout.occurs = layout.start + ((size_t)local.B+1)*sizeof(int);
+  layout.masks = 0;
+  layout.weights = 0;
+  layout.ring = layout.occurs + total*sizeof(occurrence);
+  if(local.weights != NULL) {
+    layout.weights = roundup(layout.ring, 8);
+    layout.ring = layout.weights + (size_t)local.numclauses*sizeof(weight);
+  }
+  if(local.words > 0) {
+    layout.masks = roundup(layout.ring, 8);
+    layout.ring = layout.masks + (size_t)2*local.words*local.numclauses*sizeof(uint64_t);
+  }
+  layout.ring = roundup(layout.ring, page);
+  layout.slotsize = sizeof(elite) + layout.stride*sizeof(uint64_t);
+  sh->size = layout.ring + ELITES*layout.slotsize;
+  if(ftruncate(fd, sh->size) != 0) {
+    freesat(&local);
+    return 0;
+  }
+  sh->base = (char *)mmap(NULL, sh->size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  if(sh->base == MAP_FAILED) {
+    freesat(&local);
+    return 0;
+  }
+  //ftruncate zeroed the segment, which leaves ready, users, head and the seqs at 0
+  //and keeps the creator recorded above
+  seg = (segment *)sh->base;
+  seg->id = id;
+  seg->numclauses = layout.numclauses;
+  seg->B = layout.B;
+  seg->words = layout.words;
+  seg->stride = layout.stride;
+  seg->numlits = layout.numlits;
+  seg->hard = local.hard;
+  seg->total = local.total;
+  seg->clauses = layout.clauses;
+  seg->lits = layout.lits;
+  seg->start = layout.start;
+  seg->occurs = layout.occurs;
+  seg->weights = layout.weights;
+  seg->masks = layout.masks;
+  seg->ring = layout.ring;
+  seg->slotsize = layout.slotsize;
+  memcpy(sh->base + seg->clauses, local.clauses, (size_t)local.numclauses*sizeof(clause));
+  memcpy(sh->base + seg->lits, local.lits, (size_t)local.numlits*sizeof(literal));
+  memcpy(sh->base + seg->start, local.start, ((size_t)local.B+1)*sizeof(int));
+  memcpy(sh->base + seg->occurs, local.occurs, total*sizeof(occurrence));
+  if(local.weights != NULL)
+    memcpy(sh->base + seg->weights, local.weights, (size_t)local.numclauses*sizeof(weight));
+  if(local.words > 0)
+    memcpy(sh->base + seg->masks, local.masks, (size_t)2*local.words*local.numclauses*sizeof(uint64_t));
+  freesat(&local);
+  //count ourselves before anyone can attach, so that a follower that
+  //detaches first does not take the count to zero and remove the segment
+  atomic_store_explicit(&seg->users, 1, memory_order_relaxed);
+  atomic_store_explicit(&seg->ready, 1, memory_order_release);
+  return 1;
+}
+
+//report a segment whose first process died before writing the instance
+static void left_behind(shared *sh) {
+  printf("Shared memory segment %s was left behind by a crash; remove it from /dev/shm.\n", sh->name);
+}
+
+//map the segment of fd once the first process has written it, if it
+//holds the instance filename
+static int open_segment(shared *sh, int fd, char *filename) {
+  struct stat st;
+  segment *seg;
+  size_t head;
+  int t, pid;
+  //the first process sizes the header as soon as it has created the
+  //segment, so one that stays empty was left behind by a crash
+  for(t = 0; ; t++) {
+    if(fstat(fd, &st) != 0) return 0;
+    if(st.st_size > 0) break;
+    if(t == SHARE_TIMEOUT) {
+      left_behind(sh);
+      return 0;
+    }
+    usleep(1000);
+  }
+  head = roundup(sizeof(segment), sysconf(_SC_PAGESIZE));
+  seg = (segment *)mmap(NULL, head, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  if(seg == MAP_FAILED) return 0;
+  //Parsing a large instance can take far longer than any fixed timeout,
+  //so wait for as long as the first process is alive. Only if it never
+  //got to record its pid is it given up on after SHARE_TIMEOUT.
+  for(t = 0; !atomic_load_explicit(&seg->ready, memory_order_acquire); t++) {
+    pid = atomic_load(&seg->creator);
+    if((pid == 0 ? t >= SHARE_TIMEOUT : kill(pid, 0) != 0 && errno == ESRCH)
+       && !atomic_load_explicit(&seg->ready, memory_order_acquire)) {
+      munmap(seg, head);
+      left_behind(sh);
+      return 0;
+    }
+    usleep(1000);
+  }
+  munmap(seg, head);
+  //the segment has its full size once it is ready
+  if(fstat(fd, &st) != 0) return 0;
+  sh->size = st.st_size;
+  sh->base = (char *)mmap(NULL, sh->size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  if(sh->base == MAP_FAILED) return 0;
+  seg = (segment *)sh->base;
+  if(!same_instance(filename, &seg->id)) {
+    printf("Shared memory segment %s holds another instance; choose another name, or remove\n", sh->name);
+    printf("it from /dev/shm if it was left behind by a crash.\n");
+    munmap(sh->base, sh->size);
+    return 0;
+  }
+  return 1;
+}
+
+//Remove the name of the segment, if it still refers to the one we
+//mapped. A process that attached just as the last one detached holds a
+//segment that has already been removed, and its name may since have
+//been given to a new one.
+static void unlink_own(shared *sh) {
+  struct stat st;
+  int fd;
+  fd = shm_open(sh->name, O_RDONLY, 0);
+  if(fd < 0) return;
+  if(fstat(fd, &st) == 0 && st.st_dev == sh->dev && st.st_ino == sh->ino) shm_unlink(sh->name);
+  close(fd);
+}
+
+//attach to the segment, creating it if need be
+int attach_shared(shared *sh, char *name, char *filename, instance *sat) {
+  segment *seg;
+  struct stat st;
+  int fd, ok, created;
+  sh->name = name;
+  sh->owner = (int)getpid();
+  fd = shm_open(name, O_RDWR|O_CREAT|O_EXCL, 0600);
+  created = fd >= 0;
+  if(created) {
+    ok = create_segment(sh, fd, filename);
+    if(!ok) shm_unlink(name);
+  }
+  else if(errno == EEXIST) {
+    fd = shm_open(name, O_RDWR, 0);
+    ok = fd >= 0 && open_segment(sh, fd, filename);
+  }
+  else ok = 0;
+  if(ok && fstat(fd, &st) == 0) {
+    sh->dev = st.st_dev;
+    sh->ino = st.st_ino;
+  }
+  else if(ok) {
+    munmap(sh->base, sh->size);
+    if(created) shm_unlink(name);
+    ok = 0;
+  }
+  if(fd >= 0) close(fd);
+  if(!ok) {
+    printf("Unable to attach to shared memory segment %s.\n", name);
+    return 0;
+  }
+  seg = (segment *)sh->base;
+  sh->buf = (uint64_t *)malloc(seg->stride*sizeof(uint64_t));
+  if(sh->buf == NULL) {
+    printf("Memory allocation error in attach_shared.\n");
+    //a follower has not counted itself yet, but the first process has
+    if(created && atomic_fetch_sub(&seg->users, 1) == 1) unlink_own(sh);
+    munmap(sh->base, sh->size);
+    return 0;
+  }
+  //the first process counted itself before publishing the instance
+  if(!created) atomic_fetch_add(&seg->users, 1);
+  //nobody writes the instance from here on
+  mprotect(sh->base + seg->clauses, seg->ring - seg->clauses, PROT_READ);
+  sat->numclauses = seg->numclauses;
+  sat->B = seg->B;
+  sat->words = seg->words;
+  sat->clauses = (clause *)(sh->base + seg->clauses);
+  sat->lits = (literal *)(sh->base + seg->lits);
+  sat->numlits = seg->numlits;
+  sat->masks = seg->masks > 0 ? (uint64_t *)(sh->base + seg->masks) : NULL;
+  sat->start = (int *)(sh->base + seg->start);
+  sat->occurs = (occurrence *)(sh->base + seg->occurs);
+  sat->weights = seg->weights > 0 ? (weight *)(sh->base + seg->weights) : NULL;
+  sat->hard = seg->hard;
+  sat->total = seg->total;
+  sat->mapping = NULL;
+  return 1;
+}
+
+//detach from the segment
+void detach_shared(shared *sh) {
+  segment *seg;
+  seg = (segment *)sh->base;
+  free(sh->buf);
+  if(atomic_fetch_sub(&seg->users, 1) == 1) unlink_own(sh);
+  munmap(sh->base, sh->size);
+}
+
+//write a bitstring into the next slot of the ring, unless someone else is writing it
+static void publish(shared *sh, uint64_t *bs, weight unsat) {
+  segment *seg;
+  elite *e;
+  unsigned int s;
+  seg = (segment *)sh->base;
+  e = slot(sh, (int)(atomic_fetch_add(&seg->head, 1)%ELITES));
+  s = atomic_load_explicit(&e->seq, memory_order_relaxed);
+  if((s&1) || !atomic_compare_exchange_strong(&e->seq, &s, s+1)) return;
+  e->unsat = unsat;
+  e->owner = sh->owner;
+  memcpy(e+1, bs, seg->stride*sizeof(uint64_t));
+  atomic_store_explicit(&e->seq, s+2, memory_order_release);
+}
+
+//copy a random slot of the ring published by another process into sh->buf
+//and return its unsat, or -1 if there is none or it was being written
+static weight fetch(shared *sh, rng *r) {
+  segment *seg;
+  elite *e;
+  unsigned int s;
+  uint64_t n;
+  weight unsat;
+  int owner;
+  seg = (segment *)sh->base;
+  n = atomic_load_explicit(&seg->head, memory_order_relaxed);
+  if(n == 0) return -1;
+  if(n > ELITES) n = ELITES;
+  e = slot(sh, randint(r, (int)n));
+  s = atomic_load_explicit(&e->seq, memory_order_acquire);
+  if(s == 0 || (s&1)) return -1;
+  unsat = e->unsat;
+  owner = e->owner;
+  memcpy(sh->buf, e+1, seg->stride*sizeof(uint64_t));
+  atomic_thread_fence(memory_order_acquire);
+  if(atomic_load_explicit(&e->seq, memory_order_relaxed) != s || owner == sh->owner) return -1;
+  return unsat;
+}
+
+//trade walkers with the elite ring
+void share_elites(shared *sh, population *pop, instance *sat, rng *r) {
+  int w;
+  weight u;
+  w = population_pick(pop, pop->umin, pop->umin, r);
+  publish(sh, pop->walkers[w].bs, pop->unsat[w]);
+  u = fetch(sh, r);
+  if(u >= 0 && u < pop->umax) {
+    w = population_pick(pop, pop->umax, pop->umax, r);
+    place(pop, w, sh->buf, sat);
+  }
+}
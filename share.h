@@ -0,0 +1,90 @@
+#ifndef SHARE_H
+#define SHARE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+#include "sat.h"
+#include "rng.h"
+#include "population.h"
+#include "cache.h"
+
+//Solver processes on the same host can cooperate through a named POSIX
+//shared memory segment. The first process to attach loads the instance
+//and writes its clauses, occurrence index, weights and dense masks into the
+//segment, and the others map them read-only instead of parsing the
+//file themselves, waiting for as long as the first process is alive
+//to finish. The segment records which instance it was built
+//from, and a process given a different instance under the same name,
+//or finding a segment left behind by an earlier run on another
+//instance, refuses it rather than trade walkers that mean nothing to
+//it. The segment also holds a ring of elite walkers,
+//which every process publishes its best walkers to and teleports its
+//worst walkers from. Each slot of the ring is a seqlock, so neither
+//readers nor writers ever wait; a write that collides with another is
+//dropped, and a read that collides with a write is retried later.
+
+//the number of slots in the elite ring
+#define ELITES 64
+
+//the start of the segment, written by the first process
+typedef struct {
+  atomic_int ready;    //set once the instance has been written
+  atomic_int creator;  //the pid of the process writing it
+  atomic_int users;    //number of processes attached
+  atomic_ulong head;   //number of elites published so far
+  fileid id;           //the instance it was built from
+  int numclauses;      //the instance
+  int B;
+  int words;
+  int stride;          //words per elite bitstring, padded like the walkers'
+  int numlits;
+  weight hard;         //the weight of a hard clause
+  weight total;        //and of all the clauses
+  size_t clauses;      //offset of the clauses
+  size_t lits;         //offset of their literals
+  size_t start;        //offset of the start of the occurrences of each variable
+  size_t occurs;       //offset of the occurrences
+  size_t weights;      //offset of the weights, 0 if unweighted
+  size_t masks;        //offset of the dense masks, 0 if sparse
+  size_t ring;         //offset of the elite ring
+  size_t slotsize;     //bytes per slot of the ring
+}segment;
+
+//one slot of the elite ring; the bitstring follows
+typedef struct {
+  atomic_uint seq;     //odd while being written, 0 if never written
+  int owner;           //the pid of the process that published it
+  weight unsat;        //the unsat of the walker
+}elite;
+
+//a process's view of the segment
+typedef struct {
+  char *name;          //the name of the segment
+  char *base;          //where it is mapped
+  size_t size;         //its size in bytes
+  int owner;           //our pid
+  dev_t dev;           //the segment we mapped, which the name may
+  ino_t ino;           //no longer refer to by the time we detach
+  uint64_t *buf;       //room for one bitstring
+}shared;
+
+//Attach to the segment called name, creating it from the instance
+//filename, as named to opensat, if it does not exist yet, and point sat at the instance in
+//the segment. Returns 0 on failure, including when an existing segment
+//holds another instance.
+int attach_shared(shared *sh, char *name, char *filename, instance *sat);
+
+//Detach from the segment, freeing what attach_shared allocated. The
+//last process to detach removes the segment, unless its name has been
+//given to another segment in the meantime. Use this instead of freesat.
+void detach_shared(shared *sh);
+
+//Publish a walker at the lowest energy of pop to the elite ring, and
+//move a walker at the highest energy of pop to an elite published by
+//another process, if that elite is lower. The histogram of pop must be
+//up to date; call population_stats afterwards.
+void share_elites(shared *sh, population *pop, instance *sat, rng *r);
+
+#endif
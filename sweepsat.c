@@ -22,152 +22,271 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <math.h>
+#include <unistd.h>
 #include "bitstrings.h"
 #include "sat.h"
 #include "walk.h"
+#include "share.h"
+#include "schedule.h"
+#include "profile.h"
+#include "generate.h"
+#include "telemetry.h"
+#include "preprocess.h"
+#include "polish.h"
 
 double vscale; //the scaling of the potential
 
-//W is the number of walkers, duration is the physical time, and 
-//instance a structure containing the SAT instance.
-void walk(int W, double duration, instance *sat) {
-  walker *walkers1;
-  walker *walkers2;
-  walker *cur;          //the current locations of walkers
-  walker *pro;          //the locations in progress
-  walker *tmp;          //temporary holder for pointer swapping
+//W is the number of walkers, sc the annealing schedule, started at
+//the duration of this run, and instance a structure containing the SAT
+//instance. The random numbers come from the streams of seed reserved
+//for this run: one for the sweep order, one for each walker and one for
+//trading with the elite ring of the shared segment sh, if it is not
+//NULL, every interval steps. The best walker seen goes into rec. If
+//pre is not NULL, sat is the simplified instance and bitstrings are
+//printed as bitstrings of the original. If pol is not NULL, a walker
+//at or below its level is polished when the polisher's schedule
+//allows, and a solution it reaches ends the run. Returns the number of solutions found.
+int walk(int W, schedule *sc, instance *sat, uint64_t seed, int trial, shared *sh, int interval, record *rec,
+	 preprocessor *pre, polisher *pol) {
+  population pop;
+  population *cur;      //the locations of walkers, updated in place
+  sweeper sw;           //the lists of the sweep
   int w;                //w indexes walker
   double s;             //current value of s
   double phop;          //probability of hopping to a neighboring vertex
-  double ptel;          //probability of teleporting to another walker's location
-  int action;           //0 = hop, 1 = teleport, 2 = sit
-  int umin, umax;       //the min&max number of unsatisfied clauses amongst occupied locations
+  double ptel;          //probability of dying per unit of potential above umin
+  weight umin, umax;    //the min&max weight of unsatisfied clauses amongst occupied locations
   int winners;          //number of times a walker hits zero potential
   double dt;            //the adjustable timestep
-  double time;          //the total time evolution elapsed
-  int dest;             //destination walker
-  int coprime;          //for a "poor-man's LCG"
+  double last_output;   //the time elapsed at the last telemetry sample
   int stepcount;
-  walkers1 = (walker *)malloc(W*sizeof(walker));
-  walkers2 = (walker *)malloc(W*sizeof(walker));
-  if(walkers1 == NULL || walkers2 == NULL) {
+  rng master;           //stream for the sweep order
+  rng *streams;         //the random number stream of each walker
+  rng elites;           //stream for trading with the elite ring
+  rng polishing;        //stream for the local search
+  int polished;         //whether the local search found the solution
+  streams = (rng *)malloc(W*sizeof(rng));
+  if(!alloc_population(&pop, W, sat, 0) || streams == NULL || !alloc_sweeper(&sw, W)) {
     printf("Unable to allocate memory for walkers.\n");
-    return;
-  }
-  for(w = 0; w < W; w++) {
-    init_bits(walkers1[w].bs, sat->B);
-    init_bits(walkers2[w].bs, sat->B);
+    return 0;
   }
   //initialize the walkers to the uniform distribution
-  cur = walkers1;
-  pro = walkers2;
-  randomize(cur, W, sat);
+  cur = &pop;
+  rng_seed(&master, seed, (uint64_t)trial<<32);
+  for(w = 0; w < W; w++) rng_seed(&streams[w], seed, ((uint64_t)trial<<32)+w+1);
+  rng_seed(&elites, seed, ((uint64_t)trial<<32)+W+1);
+  if(pol != NULL) restart_polisher(pol);
+  rng_seed(&polishing, seed, ((uint64_t)trial<<32)+W+2);
+  randomize(cur, sat, streams);
+  population_stats(cur);
+  update_record(rec, cur, sat);
   //do the time evolution
   winners = 0;
-  time = 0;
+  polished = 0;
   stepcount = 0;
+  last_output = 0;
   do {
-    s = time/duration;
-    //calculate the minimum potential amongst currently occupied locations
-    umin = cur[0].unsat;
-    umax = umin;
-    for(w = 0; w < W; w++) {
-      if(cur[w].unsat < umin) umin = cur[w].unsat;
-      if(cur[w].unsat > umax) umax = cur[w].unsat;
-    }
+    s = schedule_s(sc);
+    //the minimum potential amongst currently occupied locations
+    //was computed along with the maximum at the end of the last step
+    umin = cur->umin;
+    umax = cur->umax;
     dt = 0.99/(1.0-s+s*vscale*(double)(umax-umin)); //this ensures we have no negative probabilities
-    w = randint(W);
-    coprime = 2*randint(64)+1;
     phop = (1.0-s)*dt;
-    dest = 0;
-    do {
-      //subtracting umin yields invariance under uniform potential change
-      ptel = dt*s*vscale*(double)(cur[w].unsat-umin); //here we subtract the offset
-      action = tern(phop, ptel);
-      if(action == 2) { //sit
-        sit(&cur[w], &pro[dest], sat->B);
-        dest++;
-      }
-      //if(action == 1) walker dies, do nothing
-      if(action == 0) { //hop
-        hop(&cur[w], &pro[dest], sat);
-        dest++;
-      }
-      w = (w+coprime)%W;
-    }while(dest < W);
-    //swap pro with cur
-    tmp = pro;
-    pro = cur;
-    cur = tmp;
+    //subtracting umin yields invariance under uniform potential change
+    ptel = dt*s*vscale; //multiplied by cur->unsat[w]-umin in the sweep
+    TALLY(steps, 1);
+    TALLY_DT(dt);
+    if(sc->time == 0 || sc->time - last_output >= sc->duration/100.0) {
+      telemetry_sample(trial, sc->time, s, dt, umin, umax);
+      last_output = sc->time;
+    }
+    sweep_inplace(cur, &sw, phop, ptel, sat, &master, streams);
     stepcount++;
-    for(w = 0; w < W; w++) if(cur[w].unsat == 0) winners++;
-    time += dt;
-  }while(time < duration && winners == 0);
-  if(winners > 0) {
+    //one pass gives the winners and next step's umin and umax
+    population_stats(cur);
+    if(sh != NULL && stepcount%interval == 0) {
+      share_elites(sh, cur, sat, &elites);
+      population_stats(cur);
+    }
+    update_record(rec, cur, sat);
+    winners = cur->zeros;
+    if(winners == 0 && pol != NULL && polish_population(pol, cur, sat, rec, &polishing)) {
+      polished = 1;
+      winners = 1;
+    }
+    advance_schedule(sc, dt, umax-umin);
+  }while(!schedule_done(sc) && winners == 0);
+  if(polished) {
+    printf("Found 1 solution by polishing:\n");
+    print_original(pre, pol->bs, sat->B);
+    offer_record(rec, pol->bs, 0, sat);
+  }
+  else if(winners > 0) {
     if(winners == 1) printf("Found 1 solution:\n");
     else printf("Found %i solutions:\n", winners);
-    for(w = 0; w < W; w++) if(cur[w].unsat == 0) print_bits(cur[w].bs, sat->B);
+    for(w = 0; w < W; w++) if(cur->unsat[w] == 0) print_original(pre, cur->walkers[w].bs, sat->B);
   }
   //if no satisfying assignments were found, print the best ones------------------
   else {
-    umin = cur[0].unsat;
-    umax = umin;
-    for(w = 0; w < W; w++) {
-      if(cur[w].unsat < umin) umin = cur[w].unsat;
-      if(cur[w].unsat > umax) umax = cur[w].unsat;
-    }
-    printf("Best solutions found have %i unsatisfied clauses.\n", umin);
-    for(w = 0; w < W; w++) if(cur[w].unsat == umin) print_bits(cur[w].bs, sat->B);
+    umin = cur->umin;
+    printf("Best solutions found have %lli unsatisfied clauses.\n", (long long)umin);
+    for(w = 0; w < W; w++) if(cur->unsat[w] == umin) print_original(pre, cur->walkers[w].bs, sat->B);
   }
   //-------------------------------------------------------------------------------
-  free(walkers1);
-  free(walkers2);
+  free_population(&pop);
+  free_sweeper(&sw);
+  free(streams);
   printf("stepcount: %i\n", stepcount);
+  if(pol != NULL) printf("polished %ld walkers with %ld flips\n", pol->polishes, pol->flipped);
+  return winners;
+}
+
+//print the command line options
+void usage() {
+  printf("Usage: sweepsat [-P] [-l level] [-f flips] [-g gap] [-s seed] [-d duration] [-a schedule] [-r restarts] [-n runs]\n");
+  printf("                [-p profile] [-T telemetry] [-m name] [-k interval] filename.cnf\n");
+  printf("  -P  simplify the instance before walking (not with -m)\n");
+  printf("  -l  polish a walker with at most this many violated clauses (or\n");
+  printf("      this weight) by local search as it is reached\n");
+  printf("  -f  flips of each polish (default: 4 per bit)\n");
+  printf("  -g  timesteps between polishes while the lowest energy in the\n");
+  printf("      population does not improve (default: 100)\n");
+  printf("  -s  seed for the random number streams (default: the time)\n");
+  printf("  -d  base duration of a run (default: tuned for random 3SAT)\n");
+  printf("  -a  annealing schedule: linear (default), power:p,\n");
+  printf("      piecewise:u/s,u/s,... or adaptive:k\n");
+  printf("  -r  restart policy: fixed (default), luby or geometric:g\n");
+  printf("  -n  most runs to make before giving up (default: 10)\n");
+  printf("  -p  take the parameters from the nearest sweep entry of a\n");
+  printf("      profile written by tunesat\n");
+  printf("  -T  write the telemetry counters to a .json or .csv file\n");
+  printf("  -m  share the instance and elite walkers with other processes\n");
+  printf("      through the POSIX shared memory segment name, e.g. /dmc\n");
+  printf("  -k  timesteps between trades with the elite ring (default: 100)\n");
 }
 
 //load a SAT or MaxSAT instance and try to solve it using our Monte Carlo process
 int main(int argc, char *argv[]) {
   int W;             //number of walkers
   unsigned int seed; //seed for rng
-  double duration;   //the duration of 
+  double duration;   //the base duration of a run
   instance sat;      //the SAT instance
   int success;       //to flag successful loading of the SAT instance from the input
-  int trial;         //we run multiple trials since the algorithm is probabilistic
+  int trial;         //we restart since the algorithm is probabilistic
+  int runs;          //the most runs to make
+  schedule sc;       //the annealing schedule
+  restarts rs;       //the restart policy
+  char *anneal;      //the description of the schedule
+  char *policy;      //the description of the restart policy
+  char *profile;     //the parameter profile, or NULL
+  double tuned;      //the duration it gives
+  char *telemetry;   //the telemetry file, or NULL
   clock_t beg, end;  //for code timing
   double time_spent; //for code timing
+  int opt;           //for parsing the command line
+  shared sh;         //the shared memory segment
+  char *name;        //its name, or NULL
+  int interval;      //timesteps between trades with it
+  record best;       //the best walker of all the trials
+  int simplify;      //whether to preprocess the instance
+  preprocessor pre;  //how to undo that
+  weight level;      //the unsat at which walkers are polished, -1 for none
+  int flips;         //flips of each polish
+  int gap;           //timesteps between polishes unless the minimum improves
+  polisher pol;      //the local search
   beg = clock();
-  if(argc != 2) {
-    printf("Usage: loadsat filename.cnf\n");
+  simplify = 0;
+  level = -1;
+  flips = 0;
+  gap = 0;
+  name = NULL;
+  interval = 100;
+  duration = 0;
+  runs = 10;
+  anneal = "linear";
+  policy = "fixed";
+  profile = NULL;
+  telemetry = NULL;
+  seed = time(NULL); //choose rng seed
+  while((opt = getopt(argc, argv, "Pl:f:g:s:d:a:r:n:p:T:m:k:")) != -1) {
+    if(opt == 'P') simplify = 1;
+    else if(opt == 'l') level = atoll(optarg);
+    else if(opt == 'f') flips = atoi(optarg);
+    else if(opt == 'g') gap = atoi(optarg);
+    else if(opt == 's') seed = strtoul(optarg, NULL, 10);
+    else if(opt == 'd') duration = atof(optarg);
+    else if(opt == 'a') anneal = optarg;
+    else if(opt == 'r') policy = optarg;
+    else if(opt == 'n') runs = atoi(optarg);
+    else if(opt == 'p') profile = optarg;
+    else if(opt == 'T') telemetry = optarg;
+    else if(opt == 'm') name = optarg;
+    else if(opt == 'k') interval = atoi(optarg);
+    else {
+      usage();
+      return 0;
+    }
+  }
+  if(optind != argc-1 || interval < 1 || runs < 1 || duration < 0
+     || !parse_schedule(&sc, anneal) || !parse_restarts(&rs, policy) || (simplify && name != NULL) || flips < 0 || gap < 0 || (level < 0 && (flips > 0 || gap > 0))) {
+    usage();
     return 0;
   }
-  success = loadsat(argv[1], &sat);
+  if(name != NULL) success = attach_shared(&sh, name, argv[optind], &sat);
+  else success = opensat(argv[optind], &sat);
   if(!success) return 0;
   //otherwise:
   printf("%i clauses, %i variables\n", sat.numclauses, sat.B);
-  seed = time(NULL); //choose rng seed
-  //seed = 1;        //for testing
-  srand(seed);       //initialize rng
-  //The following tuned parameters were obtained by trial and error.
-  //They are tuned for random 3SAT at the sat/unsat phase transition.
-  duration = 120.0*exp(0.053*(double)sat.B);
-  //the following W and vscale are copied from Brad's code
-  W = 128;
-  vscale = 1.0;
-  if(sat.B == 150) duration = 10000;
+  if(sat.weights != NULL) printf("weighted, hard clauses of weight %lli\n", (long long)sat.hard);
+  if(simplify) {
+    if(!preprocess(&sat, &pre)) return 0;
+    if(pre.active && sat.numclauses == 0) {
+      printf("Found 1 solution:\n");
+      print_original(&pre, NULL, 0);
+      free_preprocessor(&pre);
+      freesat(&sat);
+      return 0;
+    }
+  }
+  //the defaults are tuned for random 3SAT at the sat/unsat phase transition
+  if(!load_profile(profile, 1, &sat, &W, &vscale, &tuned)) return 0;
+  if(duration == 0) duration = tuned;
   //vscale = 75.0/(double)sat.B;
   //default from teleportation version
   //if(sat.B == 75) duration = 2000;
   //if(sat.B == 150) duration = 2E5;
-  printf("seed = %d\n", seed); //for reproducibility
+  printf("seed = %u\n", seed); //for reproducibility
   printf("bits = %i\n", sat.B);
   printf("walkers = %i\n", W);
   printf("duration = %e\n", duration);
   printf("vscale = %e\n", vscale);
-  for(trial = 0; trial < 10; trial++) {
-    printf("trial %i\n", trial);
-    walk(W, duration, &sat);
+  printf("schedule = %s\n", anneal);
+  printf("restarts = %s\n", policy);
+  if(telemetry != NULL && !telemetry_open(telemetry)) return 0;
+  if(name != NULL) printf("sharing through %s every %i steps\n", name, interval);
+  if(level >= 0) {
+    if(flips == 0) flips = 4*sat.B;
+    if(gap == 0) gap = 100;
+    printf("polishing at %lli with %i flips every %i steps\n", (long long)level, flips, gap);
   }
-  freesat(&sat);
+  if(!alloc_record(&best, &sat) || (level >= 0 && !alloc_polisher(&pol, &sat, level, flips, gap))) {
+    printf("Unable to allocate memory for walkers.\n");
+    return 0;
+  }
+  //restart until some run finds a solution
+  for(trial = 0; trial < runs; trial++) {
+    start_schedule(&sc, restart_duration(&rs, trial, duration));
+    printf("trial %i: duration = %e\n", trial, sc.duration);
+    if(walk(W, &sc, &sat, seed, trial, name != NULL ? &sh : NULL, interval, &best, simplify ? &pre : NULL, level >= 0 ? &pol : NULL) > 0) break;
+  }
+  if(sat.weights != NULL) print_maxsat(&sat, best.bs, best.unsat);
+  free_record(&best);
+  if(simplify) free_preprocessor(&pre);
+  if(level >= 0) free_polisher(&pol);
+  telemetry_close();
+  if(name != NULL) detach_shared(&sh);
+  else freesat(&sat);
   end = clock();
   time_spent = (double)(end - beg)/CLOCKS_PER_SEC;
   printf("runtime: %f seconds\n", time_spent);
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+#include "telemetry.h"
+
+#ifdef TELEMETRY
+
+_Thread_local counters telemetry_local;
+
+//one sample, kept until the end for JSON
+typedef struct {
+  int id;
+  double time, s, dt;
+  int64_t umin, umax;
+  counters c;
+}sample;
+
+static FILE *out;                //the telemetry file, or NULL
+static int json;                 //whether it is JSON rather than CSV
+static sample *samples;          //the samples so far, for JSON
+static int nsamples, capsamples;
+static counters totals;          //the counters flushed so far
+static clock_t start;            //the CPU time when the file was opened
+static atomic_flag busy = ATOMIC_FLAG_INIT; //guards everything above
+
+static void lock(void) {
+  while(atomic_flag_test_and_set_explicit(&busy, memory_order_acquire));
+}
+
+static void unlock(void) {
+  atomic_flag_clear_explicit(&busy, memory_order_release);
+}
+
+//open the telemetry file
+int telemetry_open(char *filename) {
+  size_t n;
+  out = fopen(filename, "w");
+  if(out == NULL) {
+    printf("Unable to write telemetry to %s.\n", filename);
+    return 0;
+  }
+  n = strlen(filename);
+  json = n >= 5 && strcmp(filename+n-5, ".json") == 0;
+  if(!json) fprintf(out, "id,time,s,dt,umin,umax,steps,evals,hops,teleports,sits,checks,flips,dtmin,dtmean,dtmax\n");
+  start = clock();
+  return 1;
+}
+
+//the counters of a CSV row, after the sample itself
+static void csv_counters(counters *c) {
+  fprintf(out, "%lu,%lu,%lu,%lu,%lu,%lu,%lu,%e,%e,%e\n", (unsigned long)c->steps, (unsigned long)c->evals,
+	  (unsigned long)c->hops, (unsigned long)c->teleports, (unsigned long)c->sits, (unsigned long)c->checks,
+	  (unsigned long)c->flips, c->dtmin, c->dts > 0 ? c->dtsum/(double)c->dts : 0, c->dtmax);
+}
+
+//the counters as the members of a JSON object
+static void json_counters(counters *c) {
+  fprintf(out, "\"steps\": %lu, \"evals\": %lu, \"hops\": %lu, \"teleports\": %lu, \"sits\": %lu, \"checks\": %lu, \"flips\": %lu, "
+	  "\"dtmin\": %e, \"dtmean\": %e, \"dtmax\": %e", (unsigned long)c->steps, (unsigned long)c->evals,
+	  (unsigned long)c->hops, (unsigned long)c->teleports, (unsigned long)c->sits, (unsigned long)c->checks,
+	  (unsigned long)c->flips, c->dtmin, c->dts > 0 ? c->dtsum/(double)c->dts : 0, c->dtmax);
+}
+
+//record a sample
+void telemetry_sample(int id, double time, double s, double dt, int64_t umin, int64_t umax) {
+  sample *x;
+  if(out == NULL) return;
+  lock();
+  if(!json) {
+    fprintf(out, "%i,%e,%e,%e,%lli,%lli,", id, time, s, dt, (long long)umin, (long long)umax);
+    csv_counters(&telemetry_local);
+    fflush(out);
+  }
+  else {
+    if(nsamples == capsamples) {
+      capsamples = 2*capsamples+64;
+      x = (sample *)realloc(samples, capsamples*sizeof(sample));
+      if(x == NULL) {
+	//keep what there is rather than stop the run
+	capsamples = nsamples;
+	unlock();
+	return;
+      }
+      samples = x;
+    }
+    x = &samples[nsamples++];
+    x->id = id;
+    x->time = time;
+    x->s = s;
+    x->dt = dt;
+    x->umin = umin;
+    x->umax = umax;
+    x->c = telemetry_local;
+  }
+  unlock();
+}
+
+//fold this thread's counters into the totals
+void telemetry_flush(void) {
+  counters *c;
+  c = &telemetry_local;
+  lock();
+  if(c->dts > 0 && (totals.dts == 0 || c->dtmin < totals.dtmin)) totals.dtmin = c->dtmin;
+  if(c->dts > 0 && (totals.dts == 0 || c->dtmax > totals.dtmax)) totals.dtmax = c->dtmax;
+  totals.steps += c->steps;
+  totals.evals += c->evals;
+  totals.hops += c->hops;
+  totals.teleports += c->teleports;
+  totals.sits += c->sits;
+  totals.checks += c->checks;
+  totals.flips += c->flips;
+  totals.dts += c->dts;
+  totals.dtsum += c->dtsum;
+  unlock();
+  memset(c, 0, sizeof(counters));
+}
+
+//write the totals and close the file
+void telemetry_close(void) {
+  int i;
+  double cpu;
+  telemetry_flush();
+  if(out == NULL) return;
+  cpu = (double)(clock() - start)/CLOCKS_PER_SEC;
+  if(!json) {
+    fprintf(out, "total,,,,,,");
+    csv_counters(&totals);
+  }
+  else {
+    fprintf(out, "{\n\"samples\": [\n");
+    for(i = 0; i < nsamples; i++) {
+      fprintf(out, "  {\"id\": %i, \"time\": %e, \"s\": %e, \"dt\": %e, \"umin\": %lli, \"umax\": %lli, ", samples[i].id,
+	      samples[i].time, samples[i].s, samples[i].dt, (long long)samples[i].umin, (long long)samples[i].umax);
+      json_counters(&samples[i].c);
+      fprintf(out, "}%s\n", i < nsamples-1 ? "," : "");
+    }
+    fprintf(out, "],\n\"totals\": {\"cpu\": %f, ", cpu);
+    json_counters(&totals);
+    fprintf(out, "}\n}\n");
+  }
+  fclose(out);
+  out = NULL;
+  free(samples);
+  samples = NULL;
+  nsamples = 0;
+  capsamples = 0;
+}
+
+#else
+
+//there is nothing to record
+int telemetry_open(char *filename) {
+  printf("Telemetry is not compiled in; rebuild with -DTELEMETRY to write %s.\n", filename);
+  return 1;
+}
+
+#endif
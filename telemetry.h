@@ -0,0 +1,74 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+//Counters on the hot paths, for seeing where the time goes without a
+//profiler. They are only compiled in when TELEMETRY is defined (add
+//-DTELEMETRY to CFLAGS); otherwise every macro below expands to
+//nothing and the solvers are exactly as fast as without them.
+//
+//Each thread counts into its own thread-local counters, so counting
+//never contends. A solver opens the telemetry file with -T, records a
+//sample of its progress now and then, and each thread folds its
+//counters into the totals with telemetry_flush before it exits. A file
+//ending in .json gets one JSON object with every sample and the
+//totals, written at the end. Any other file gets CSV, one row per
+//sample as it is recorded, so it can be watched during the run,
+//followed by a row of totals. The counters in a sample are those of
+//the thread that recorded it.
+
+//what the hot paths count
+typedef struct {
+  uint64_t steps;      //timesteps, sweeps or units of event time
+  uint64_t evals;      //clause evaluations
+  uint64_t hops;       //walkers that hopped
+  uint64_t teleports;  //walkers that teleported, or were replaced in a sweep
+  uint64_t sits;       //walkers that sat
+  uint64_t checks;     //passes over the histogram for umin, umax and winners
+  uint64_t flips;      //flips of the local search that polishes walkers
+  uint64_t dts;        //timesteps whose size was recorded
+  double dtsum;        //their total size
+  double dtmin;        //the smallest
+  double dtmax;        //the largest
+}counters;
+
+//Open the telemetry file. Returns 0 if it cannot be written. Without
+//TELEMETRY this only warns that there is nothing to record.
+int telemetry_open(char *filename);
+
+#ifdef TELEMETRY
+
+extern _Thread_local counters telemetry_local;
+
+#define TALLY(field, n) (telemetry_local.field += (uint64_t)(n))
+
+//record the size of a timestep
+static inline void TALLY_DT(double dt) {
+  if(telemetry_local.dts == 0 || dt < telemetry_local.dtmin) telemetry_local.dtmin = dt;
+  if(telemetry_local.dts == 0 || dt > telemetry_local.dtmax) telemetry_local.dtmax = dt;
+  telemetry_local.dts++;
+  telemetry_local.dtsum += dt;
+}
+
+//Record a sample of the progress of run or replica id: its physical
+//time, s, current timestep and the min and max unsat of its population.
+void telemetry_sample(int id, double time, double s, double dt, int64_t umin, int64_t umax);
+
+//fold the counters of this thread into the totals and zero them
+void telemetry_flush(void);
+
+//flush this thread's counters, write the totals and close the file
+void telemetry_close(void);
+
+#else
+
+#define TALLY(field, n) ((void)0)
+#define TALLY_DT(dt) ((void)0)
+#define telemetry_sample(id, time, s, dt, umin, umax) ((void)0)
+#define telemetry_flush() ((void)0)
+#define telemetry_close() ((void)0)
+
+#endif
+
+#endif
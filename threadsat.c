@@ -1,12 +1,14 @@
 /*-----------------------------------------------------------------
-  This software solves 3SAT using a diffusion Monte Carlo algorithm 
-  that mimics stoquastic adiabatic dynamics. It was written by
-  Stephen Jordan in 2015/2016 as part of a collaboration with
-  Michael Jarret and Brad Lackey. This version subtracts the
-  minimum potential and is therefore invariant under shifts,
-  just as the quantum adiabatic algorithm is. It also uses adaptive
+  This software solves SAT or MaxSAT using a diffusion Monte Carlo
+  algorithm that mimics stoquastic adiabatic dynamics. It was
+  written by Stephen Jordan in 2015/2016 as part of a collaboration
+  with Michael Jarret and Brad Lackey. This version subtracts the
+  minimum potential and is therefore invariant under shifts, just
+  as the quantum adiabatic algorithm is. It also uses adaptive
   timesteps, whose size is computed on the fly. This is the
-  multithreaded version suitable for multi-core machines. The
+  multithreaded version suitable for multi-core machines: a single
+  large population is split across a pool of threads, and walkers
+  may teleport to any walker in the whole population. The
   single-threaded version is dmcsat.
   -----------------------------------------------------------------*/
 
@@ -16,314 +18,369 @@
 //#define _GNU_SOURCE
 
 #include <stdio.h>
-#include <malloc.h>
+#include <malloc.h> //omit on mac
+#include <time.h>
 #include <stdlib.h>
-#include <stdint.h>  
+#include <stdint.h>
 #include <pthread.h>
 #include <math.h>
-#include <sys/time.h> 
+#include <unistd.h>
+#include <sys/time.h>
 #include "bitstrings.h"
-#include "3sat.h"
+#include "sat.h"
+#include "profile.h"
+#include "generate.h"
+#include "telemetry.h"
+#include "walk.h"
+#include "sample.h"
 
 //I use the posix gettimeofday function, rather than clock(), because
-//I want walltime, not CPU time. That's why I include /sys/time.h.
-//For storing bitstrings we want variables with exactly 64 bits
-//not some unspecified number that varies by machine. That's
-//why I include stdint.h.
-
-//If you execute nproc at the commandline it will return the number of cores.
-//I think this is a good choice for the number of threads. However, it is
-//permissible to choose the number of threads smaller or larger than that.
-#define THREADS 8
+//I want walltime, not CPU time. That's why I include sys/time.h.
 
 double vscale; //the scaling of the potential
 
+//What each thread reports about its share of the population at the
+//end of a timestep. The threads combine these into the population
+//wide values, so no thread ever writes another thread's walkers.
 typedef struct {
-  uint64_t *bs;        //bit vector
-  double potential;    //so we don't calculate this multiple times per timestep
-}walker;
+  weight umin, umax;    //min and max of unsat in the share
+  int zeros;            //number of walkers at zero
+  int nhop, ntel, nsit; //actions taken in the last timestep
+}tally;
 
+//the state shared by all of the threads of a walk
 typedef struct {
-  int W;             //number of walkers
-  double duration;   //physical duration (hbar = 1)
-  instance *sat;     //3SAT instance
-  unsigned int seed; //the master seed
-}params;
-
-//clause is violated only if all three conditions are violated
-int violated(int x1, int x2, int x3, int a, int b, int c) {
-  if(a > 0 && x1 == 1) return 0;
-  if(a < 0 && x1 == 0) return 0;
-  if(b > 0 && x2 == 1) return 0;
-  if(b < 0 && x2 == 0) return 0;
-  if(c > 0 && x3 == 1) return 0;
-  if(c < 0 && x3 == 0) return 0;
-  return 1;
-}
-
-//The potential energy of a bit string is the number of violated clauses
-//in the 3SAT instance times the scale factor vscale.
-double potential(walker *w, instance *sat) {
-  int c;
-  int x1, x2, x3;
-  int v;
-  v = 0;
-  for(c = 0; c < sat->numclauses; c++) {
-    //the sat instance uses 1 as the index for the first bit, not 0
-    x1 = extract(w->bs, abs(sat->clauses[c].a)-1, sat->B);
-    x2 = extract(w->bs, abs(sat->clauses[c].b)-1, sat->B);
-    x3 = extract(w->bs, abs(sat->clauses[c].c)-1, sat->B);
-    v += violated(x1, x2, x3, sat->clauses[c].a, sat->clauses[c].b, sat->clauses[c].c);
-  }
-  return vscale*(double)v;
-}
-
-//return a random integer uniformly distributed between 0 and n-1
-int randint(int n, unsigned int *seed) {
-  if(n > RAND_MAX) {
-    printf("Out of range (%i) in randint\n", n);
-    return RAND_MAX;
-  }
-  return rand_r(seed)%n;
-}
-
-//Bernoulli random variable:
-//return 1 with probability p, 0 with probability 1-p
-int bern(double p, unsigned int *seed) {
-  int threshold;
-  if(p < 0) {
-    printf("Invalid probability %f in bern.\n", p);
-    return 1;
-  }
-  if(p > 1) {
-    printf("Invalid probability %f in bern.\n", p);
-    return 0;
-  }
-  threshold = (int)(p*(double)RAND_MAX);
-  if(rand_r(seed) < threshold) return 1;
-  return 0;
-}
-
-//ternary Bernoulli random variable
-//return 0 with probability p0, 1 with probability p1, 2 otherwise 
-int tern(double p0, double p1, unsigned int *seed) {
-  int threshold1, threshold2;
-  int r;
-  if(p0 < 0 || p1 < 0 || p0+p1 > 1) {
-    printf("Invalid probabilities %f %f in tern.\n", p0, p1);
-    return 0;
-  }
-  threshold1 = (int)(p0*(double)RAND_MAX);
-  threshold2 = (int)((p0+p1)*(double)RAND_MAX);
-  r = rand_r(seed);
-  if(r < threshold1) return 0;
-  if(r < threshold2) return 1;
-  return 2;
-}
-
-//Hop to a random neighbor by flipping one bit.
-void hop(walker *cur, walker *pro, int w, instance *sat, unsigned int *seed) {
-  int bflip;            //the index of the bit that gets flipped
-  int diff;             //the difference between the postflip and preflip potentials
-  int oldval, newval;   //pre- and post-flip values of a given clause
-  int i;                //an counter for the containment list of the flipped variable
-  int cnum;             //a clause number from the containment list
-  int avar, bvar, cvar; //the indices for the variables in the current clause
-  int x, y, z;          //the preflip values of the variables in the current clause
-  int xf, yf, zf;       //the postflip values of the variables in the current clause
-  bflip = randint(sat->B, seed);
-  diff = 0;
-  copy_bits(cur[w].bs, pro[w].bs, sat->B);
-  flip(pro[w].bs, bflip, sat->B);
-  //Only in the hop case do we need to calculate a new potential.
-  //Furthermore, we only need to recalculate the clauses that contain the flipped bit.
-  for(i = 0; i < sat->presence[bflip].num; i++) {
-    cnum = sat->presence[bflip].list[i];
-    avar = abs(sat->clauses[cnum].a)-1;
-    bvar = abs(sat->clauses[cnum].b)-1;
-    cvar = abs(sat->clauses[cnum].c)-1;
-    x = extract(cur[w].bs, avar, sat->B);
-    y = extract(cur[w].bs, bvar, sat->B);
-    z = extract(cur[w].bs, cvar, sat->B);
-    if(avar == bflip) xf = 1-x;
-    else xf = x;
-    if(bvar == bflip) yf = 1-y;
-    else yf = y;
-    if(cvar == bflip) zf = 1-z;
-    else zf = z;
-    oldval = violated(x, y, z,    sat->clauses[cnum].a, sat->clauses[cnum].b, sat->clauses[cnum].c);
-    newval = violated(xf, yf, zf, sat->clauses[cnum].a, sat->clauses[cnum].b, sat->clauses[cnum].c);
-    diff += newval - oldval;
-  }
-  pro[w].potential = cur[w].potential + vscale*(double)diff;
-}
-
-//teleport to the location of a randomly chosen walker
-void teleport(walker *cur, walker *pro, int w, int W, int B, unsigned int *seed) {
-  int destination;
-  destination = randint(W, seed);
-  copy_bits(cur[destination].bs, pro[w].bs, B);
-  pro[w].potential = cur[destination].potential;
-}
+  int W;                     //number of walkers
+  int T;                     //number of threads
+  double duration;           //physical duration (hbar = 1)
+  instance *sat;             //the SAT instance
+  population whole[2];       //the current and prospective populations
+  population *parts;         //parts[2*t+k] is thread t's share of whole[k]
+  actions *acts;             //the action lists of each thread
+  rng *streams;              //the random number stream of each walker
+  tally *tallies;            //what each thread found at the end of the step
+  record *records;           //the best walker of each thread's share so far
+  population *final;         //the population after the last step
+  pthread_barrier_t barrier; //the threads meet here twice per timestep
+}engine;
 
-//sit where you are
-void sit(walker *cur, walker *pro, int w, int B) {
-  copy_bits(cur[w].bs, pro[w].bs, B);
-  pro[w].potential = cur[w].potential;
-}
+//the argument of each thread
+typedef struct {
+  engine *e;
+  int t;
+}worker;
 
-//distribute the walkers uniformly at random
-void randomize(walker *warray, int W, instance *sat, unsigned int *seed) {
-  int w, b, val;
-  for(w = 0; w < W; w++) {
-    for(b = 0; b < sat->B; b++) {
-      val = bern(0.5, seed);
-      if(val == 1) flip(warray[w].bs, b, sat->B);
-    }
-    warray[w].potential = potential(&warray[w], sat);
-  }
+//the first walker of thread t's share
+static int share(int W, int T, int t) {
+  return (int)((int64_t)W*t/T);
 }
 
-//W is the number of walkers, duration is the physical time, and 
-//instance a structure containing the 3SAT instance.
-void *walk(void *arg) {
-  walker *walkers1;
-  walker *walkers2;
-  walker *cur;            //the current locations of walkers
-  walker *pro;            //the locations in progress
-  walker *tmp;            //temporary holder for pointer swapping
-  int w;                  //w indexes walker
-  double s;               //current value of s
-  double phop;            //probability of hopping to a neighboring vertex
-  double ptel;            //probability of teleporting to another walker's location
-  int action;             //0 = hop, 1 = teleport, 2 = sit
-  double vmin, vmax;      //the minimum and maximum potential amongst occupied locations
-  double dt;              //the adjustable timestep
-  double time;            //physical time elapsed
-  int winners;            //the number of walkers at potential zero
-  params *para;           //the walk parameters
-  unsigned int seed;      //random seed
-  unsigned int init_seed; //for reference, since rand_r modifies seed
-  double duration;        //physical duration
-  int W;                  //number of walkers
-  instance *sat;          //the 3SAT instance
-  para = (params *)arg;
-  W = para->W;
-  seed = para->seed;      //we have a different seed for each thread
-  init_seed = seed;       //we print this out for reproducibility
-  duration = para->duration;
-  sat = para->sat;
-  walkers1 = (walker *)malloc(W*sizeof(walker));
-  walkers2 = (walker *)malloc(W*sizeof(walker));
-  if(walkers1 == NULL || walkers2 == NULL) {
-    printf("Unable to allocate memory for walkers.\n");
-    return NULL;
-  }
-  for(w = 0; w < W; w++) {
-    init_bits(&(walkers1[w].bs), sat->B);
-    init_bits(&(walkers2[w].bs), sat->B);
-  }
+//Evolve thread t's share of the population. Every thread computes the
+//same timestep from the combined tallies, so the threads agree on
+//when to stop without any further communication. Walker w draws all
+//of its random numbers from stream w, so the trajectory does not
+//depend on the number of threads.
+void *work(void *arg) {
+  engine *e;
+  int t;
+  int lo;               //the first walker of this thread's share
+  population *cur;      //this thread's share of the current population
+  population *pro;      //this thread's share of the prospective population
+  population *gcur;     //the whole current population, for teleports
+  population *gpro;     //the whole prospective population
+  population *tmp;      //temporary holder for pointer swapping
+  actions *act;         //this thread's actions
+  tally *mine;          //this thread's tally
+  int w, i;
+  double s;             //current value of s
+  double phop;          //probability of hopping to a neighboring vertex
+  double ptel;          //probability of teleporting per unit of potential above umin
+  weight umin, umax;    //the min&max weight of unsatisfied clauses amongst occupied locations
+  int winners;          //number of walkers at zero potential
+  int sitters;          //number of times a walker sits in place
+  int teleporters;      //number of times a walker teleports
+  int hoppers;          //number of times a walker hops
+  double dt;            //the adjustable timestep
+  double time;          //the total time evolution elapsed
+  double last_output;   //the time elapsed at the last screen output
+  int steps;            //steps since last screen output
+  e = ((worker *)arg)->e;
+  t = ((worker *)arg)->t;
+  lo = share(e->W, e->T, t);
+  cur = &(e->parts[2*t]);
+  pro = &(e->parts[2*t+1]);
+  gcur = &(e->whole[0]);
+  gpro = &(e->whole[1]);
+  act = &(e->acts[t]);
+  mine = &(e->tallies[t]);
   //initialize the walkers to the uniform distribution
-  cur = walkers1;
-  pro = walkers2;
-  randomize(cur, W, sat, &seed);
+  randomize(cur, e->sat, e->streams+lo);
+  population_stats(cur);
+  update_record(&e->records[t], cur, e->sat);
+  mine->umin = cur->umin;
+  mine->umax = cur->umax;
+  mine->zeros = cur->zeros;
+  mine->nhop = 0;
+  mine->ntel = 0;
+  mine->nsit = 0;
+  pthread_barrier_wait(&e->barrier);
   //do the time evolution
-  winners = 0;
+  teleporters = 0;
+  hoppers = 0;
+  sitters = 0;
   time = 0;
-  do {
-    s = time/duration;
-    //calculate the minimum potential amongst currently occupied locations
-    vmin = cur[0].potential;
-    vmax = vmin;
-    for(w = 0; w < W; w++) {
-      if(cur[w].potential < vmin) vmin = cur[w].potential;
-      if(cur[w].potential > vmax) vmax = cur[w].potential;
+  dt = 0;
+  last_output = 0;
+  steps = 0;
+  while(1) {
+    //combine the tallies of the last step
+    umin = e->tallies[0].umin;
+    umax = e->tallies[0].umax;
+    winners = 0;
+    for(i = 0; i < e->T; i++) {
+      if(e->tallies[i].umin < umin) umin = e->tallies[i].umin;
+      if(e->tallies[i].umax > umax) umax = e->tallies[i].umax;
+      winners += e->tallies[i].zeros;
+      if(t == 0) {
+	teleporters += e->tallies[i].ntel;
+	hoppers += e->tallies[i].nhop;
+	sitters += e->tallies[i].nsit;
+      }
+    }
+    if(t == 0 && steps > 0 && (steps == 1 || time - last_output >= e->duration/100.0)) {
+      //periodically output some statistics:
+      printf("sitters: %e\thoppers: %e\tteleporters: %e\tviolated = %lli\n",
+	     (double)sitters/((double)e->W*steps), (double)hoppers/((double)e->W*steps),
+	     (double)teleporters/((double)e->W*steps), (long long)umin);
+      telemetry_sample(0, time, time/e->duration, dt, umin, umax);
+      sitters = 0;
+      teleporters = 0;
+      hoppers = 0;
+      last_output = time;
+      steps = 0;
     }
-    dt = 0.99/(1.0-s+s*(double)(vmax-vmin)); //this ensures we have no negative probabilities
-    for(w = 0; w < W; w++) {
-      phop = (1.0-s)*dt;
-      //subtracting vmin yields invariance under uniform potential change
-      ptel = dt*s*(cur[w].potential-vmin); //here we subtract the offset
-      action = tern(phop, ptel, &seed);
-      if(action == 2) sit(cur, pro, w, sat->B);
-      if(action == 1) teleport(cur, pro, w, W, sat->B, &seed);
-      if(action == 0) hop(cur, pro, w, sat, &seed);
+    if(time >= e->duration || winners > 0) break;
+    s = time/e->duration;
+    dt = 0.99/(1.0-s+s*vscale*(double)(umax-umin)); //this ensures we have no negative probabilities
+    phop = (1.0-s)*dt;
+    //subtracting umin yields invariance under uniform potential change
+    ptel = dt*s*vscale; //multiplied by cur->unsat[w]-umin in the sampler
+    if(t == 0) {
+      TALLY(steps, 1);
+      TALLY_DT(dt);
     }
+    sample_actions(act, cur, umin, phop, ptel, e->streams+lo);
+    //teleports may read any walker of the whole population
+    for(i = 0; i < act->ntel; i++) {
+      w = act->teleports[i];
+      teleport(gcur, pro, w, e->sat, &(e->streams[lo+w]));
+    }
+    //every thread must be done teleporting before hops and sits take
+    //over the storage of cur in the incremental mode, and done
+    //combining the tallies of the last step before any of them posts
+    //its own for this one
+    pthread_barrier_wait(&e->barrier);
+    for(i = 0; i < act->nhop; i++) {
+      w = act->hops[i];
+      hop(cur, w, pro, w, e->sat, &(e->streams[lo+w]));
+    }
+    for(i = 0; i < act->nsit; i++) {
+      w = act->sits[i];
+      sit(cur, w, pro, w, e->sat);
+    }
+    population_stats(pro);
+    update_record(&e->records[t], pro, e->sat);
+    mine->umin = pro->umin;
+    mine->umax = pro->umax;
+    mine->zeros = pro->zeros;
+    mine->nhop = act->nhop;
+    mine->ntel = act->ntel;
+    mine->nsit = act->nsit;
     //swap pro with cur
     tmp = pro;
     pro = cur;
     cur = tmp;
-    //we shouldn't compare the potential to zero because of rounding errors
-    for(w = 0; w < W; w++) if(fabs(cur[w].potential) < 0.00001) winners++;
+    tmp = gpro;
+    gpro = gcur;
+    gcur = tmp;
+    steps++;
     time += dt;
-  }while(time < duration && winners == 0);
-  if(winners > 0) {
-    if(winners == 1) printf("Seed %u found 1 solution:\n", init_seed);
-    else printf("Seed %u found %i solutions:\n", init_seed, winners);
-    for(w = 0; w < W; w++) if(fabs(cur[w].potential) < 0.00001) print_bits(cur[w].bs, sat->B);
+    pthread_barrier_wait(&e->barrier);
+  }
+  if(t == 0) {
+    e->final = gcur;
+    //the histogram of the whole was not kept up to date by the threads
+    gcur->umin = umin;
+    gcur->umax = umax;
+    gcur->zeros = winners;
+  }
+  telemetry_flush();
+  return NULL;
+}
+
+//W is the number of walkers, duration is the physical time, and
+//instance a structure containing the SAT instance. The population is
+//split evenly amongst T threads. If incremental is nonzero the walkers
+//cache their clause counts and flip deltas. Walker w draws all of its
+//random numbers from stream w of seed.
+void walk(int W, int T, double duration, instance *sat, int incremental, uint64_t seed) {
+  engine e;
+  worker *workers;      //the arguments of the threads
+  pthread_t *threads;   //the thread pool
+  population *cur;      //the population after the last step
+  record *best;         //the best walker of all the threads
+  int w, t, k;
+  int rc;               //error code from thread creation
+  e.W = W;
+  e.T = T;
+  e.duration = duration;
+  e.sat = sat;
+  e.parts = (population *)malloc(2*T*sizeof(population));
+  e.acts = (actions *)malloc(T*sizeof(actions));
+  e.tallies = (tally *)malloc(T*sizeof(tally));
+  e.streams = (rng *)malloc(W*sizeof(rng));
+  e.records = (record *)malloc(T*sizeof(record));
+  workers = (worker *)malloc(T*sizeof(worker));
+  threads = (pthread_t *)malloc(T*sizeof(pthread_t));
+  if(e.parts == NULL || e.acts == NULL || e.tallies == NULL || e.streams == NULL
+     || e.records == NULL || workers == NULL || threads == NULL
+     || !alloc_population(&e.whole[0], W, sat, incremental)
+     || !alloc_population(&e.whole[1], W, sat, incremental)) {
+    printf("Unable to allocate memory for walkers.\n");
+    return;
+  }
+  for(t = 0; t < T; t++) {
+    for(k = 0; k < 2; k++) {
+      if(!population_slice(&e.whole[k], &e.parts[2*t+k], share(W, T, t), share(W, T, t+1))) {
+	printf("Unable to allocate memory for walkers.\n");
+	return;
+      }
+    }
+    if(!alloc_actions(&e.acts[t], share(W, T, t+1)-share(W, T, t)) || !alloc_record(&e.records[t], sat)) {
+      printf("Unable to allocate memory for walkers.\n");
+      return;
+    }
+  }
+  for(w = 0; w < W; w++) rng_seed(&e.streams[w], seed, w);
+  pthread_barrier_init(&e.barrier, NULL, T);
+  for(t = 0; t < T; t++) {
+    workers[t].e = &e;
+    workers[t].t = t;
+    rc = pthread_create(&threads[t], NULL, work, (void *)&workers[t]);
+    if(rc) {
+      printf("Error: return code from thread is %d\n", rc);
+      exit(0);
+    }
+  }
+  for(t = 0; t < T; t++) pthread_join(threads[t], NULL);
+  pthread_barrier_destroy(&e.barrier);
+  cur = e.final;
+  if(cur->zeros > 0) {
+    if(cur->zeros == 1) printf("Found 1 solution:\n");
+    else printf("Found %i solutions:\n", cur->zeros);
+    for(w = 0; w < W; w++) if(cur->unsat[w] == 0) print_bits(cur->walkers[w].bs, sat->B);
   }
   else {
-    vmin = cur[0].potential;
-    for(w = 0; w < W; w++) if(cur[w].potential < vmin) vmin = cur[w].potential;
-    printf("Seed %u: best approximations found: %i clauses violated.\n", init_seed, (int)round(vmin/vscale));
-    for(w = 0; w < W; w++) if(cur[w].potential == vmin) print_bits(cur[w].bs, sat->B);
+    printf("Best approximations found: %lli clauses violated.\n", (long long)cur->umin);
+    for(w = 0; w < W; w++) if(cur->unsat[w] == cur->umin) print_bits(cur->walkers[w].bs, sat->B);
   }
-  for(w = 0; w < W; w++) {
-    free_bits(walkers1[w].bs);
-    free_bits(walkers2[w].bs);
+  best = &e.records[0];
+  for(t = 1; t < T; t++) if(e.records[t].unsat < best->unsat) best = &e.records[t];
+  if(sat->weights != NULL) print_maxsat(sat, best->bs, best->unsat);
+  for(t = 0; t < T; t++) {
+    free_slice(&e.parts[2*t]);
+    free_slice(&e.parts[2*t+1]);
+    free_actions(&e.acts[t]);
+    free_record(&e.records[t]);
   }
-  free(walkers1);
-  free(walkers2);
-  return NULL;
+  free_population(&e.whole[0]);
+  free_population(&e.whole[1]);
+  free(e.parts);
+  free(e.acts);
+  free(e.tallies);
+  free(e.streams);
+  free(e.records);
+  free(workers);
+  free(threads);
+}
+
+//print the command line options
+void usage() {
+  printf("Usage: threadsat [-i] [-s seed] [-t threads] [-w walkers] [-p profile]\n");
+  printf("                 [-T telemetry] filename.cnf\n");
+  printf("  -i  cache clause counts and flip deltas in each walker\n");
+  printf("  -s  seed for the random number streams (default: the time)\n");
+  printf("  -t  number of threads (default: the number of cores)\n");
+  printf("  -w  number of walkers in the population (default: 10000, or the\n");
+  printf("      profile's if one is given)\n");
+  printf("  -p  take the parameters from the nearest teleport entry of a\n");
+  printf("      profile written by tunesat\n");
+  printf("  -T  write the telemetry counters to a .json or .csv file\n");
 }
 
-//Load a 3SAT instance and try to solve it using our Monte Carlo process.
-//We run THREADS parallel instances with different seeds. With any luck,
-//at least one will succeed.
+//load a SAT instance and try to solve it using our Monte Carlo process
 int main(int argc, char *argv[]) {
   int W;                      //number of walkers
-  double duration;            //the physical time for the adiabatic process (hbar = 1)
+  int T;                      //number of threads
   unsigned int seed;          //seed for rng
-  instance sat;               //the 3SAT instance
-  int success;                //to flag successful loading of the 3SAT instance from the input
-  params para[THREADS];       //we pass these to the walk threads
-  pthread_t threads[THREADS]; //for parallel processing
-  int rc;                     //error code from thread creation
-  unsigned int t;             //counter variable for threads
+  double duration;            //the physical time for the adiabatic process (hbar = 1)
+  instance sat;               //the SAT instance
+  int success;                //to flag successful loading of the SAT instance from the input
+  int incremental;            //whether to use the incremental hop
+  int opt;                    //for parsing the command line
+  char *profile;              //the parameter profile, or NULL
+  int tuned;                  //the number of walkers it gives
+  char *telemetry;            //the telemetry file, or NULL
   struct timeval tv1, tv2;    //UNIX time at beginning and end
   double walltime;            //the duration of the computation
   gettimeofday(&tv1, NULL);
-  if(argc != 2) {
-    printf("Usage: loadsat filename.cnf\n");
+  incremental = 0;
+  seed = time(NULL); //choose rng seed
+  //If you execute nproc at the commandline it will return the number
+  //of cores. This is a good choice for the number of threads, but
+  //it is permissible to choose fewer or more.
+  T = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if(T < 1) T = 1;
+  W = 0;
+  profile = NULL;
+  telemetry = NULL;
+  while((opt = getopt(argc, argv, "is:t:w:p:T:")) != -1) {
+    if(opt == 'i') incremental = 1;
+    else if(opt == 's') seed = strtoul(optarg, NULL, 10);
+    else if(opt == 't') T = atoi(optarg);
+    else if(opt == 'w') W = atoi(optarg);
+    else if(opt == 'p') profile = optarg;
+    else if(opt == 'T') telemetry = optarg;
+    else {
+      usage();
+      return 0;
+    }
+  }
+  if(optind != argc-1 || T < 1 || W < 0) {
+    usage();
     return 0;
   }
-  success = loadsat(argv[1], &sat);
+  success = opensat(argv[optind], &sat);
   if(!success) return 0;
   //otherwise:
   printf("%i clauses, %i variables\n", sat.numclauses, sat.B);
-  seed = time(NULL); //choose rng seed
-  //The following tuned parameters were obtained by trial and error.
-  //They are tuned for random 3SAT at the sat/unsat phase transition.
-  W = 50;
-  vscale = 75.0/(double)sat.B;
-  duration = 188.0*exp(0.053*(double)sat.B);
-  printf("master seed = %u\n", seed); //for reproducibility
+  if(sat.weights != NULL) printf("weighted, hard clauses of weight %lli\n", (long long)sat.hard);
+  //The defaults are tuned for random 3SAT at the sat/unsat phase
+  //transition, but a single large population is the point here.
+  if(!load_profile(profile, 0, &sat, &tuned, &vscale, &duration)) return 0;
+  if(W == 0) W = profile != NULL ? tuned : 10000;
+  //every thread needs at least one walker
+  if(T > W) T = W;
+  printf("seed = %u\n", seed); //for reproducibility
   printf("bits = %i\n", sat.B);
   printf("walkers = %i\n", W);
+  printf("threads = %i\n", T);
   printf("duration = %e\n", duration);
   printf("vscale = %e\n", vscale);
-  for(t = 0; t < THREADS; t++) {
-    para[t].W = W;
-    para[t].duration = duration;
-    para[t].sat = &sat;
-    para[t].seed = seed+t;  //so we have a different seed for each thread
-    rc = pthread_create(&threads[t], NULL, walk, (void *)&para[t]);
-    if(rc) {
-      printf("Error: return code from thread is %d\n", rc);
-      return 0;
-    }
-  }
-  for(t = 0; t < THREADS; t++) pthread_join(threads[t], NULL);
+  if(incremental) printf("incremental hops\n");
+  if(telemetry != NULL && !telemetry_open(telemetry)) return 0;
+  walk(W, T, duration, &sat, incremental, seed);
+  telemetry_close();
   freesat(&sat);
   gettimeofday(&tv2, NULL);
   walltime = (double)(tv2.tv_usec - tv1.tv_usec)/1000000 + (double)(tv2.tv_sec - tv1.tv_sec);
@@ -0,0 +1,261 @@
+/*-----------------------------------------------------------------
+  This program tunes the number of walkers, the scaling of the
+  potential and the duration of the diffusion Monte Carlo solvers
+  for a family of instances. It draws random candidate settings,
+  runs every candidate on short seeded trials over a benchmark set,
+  and repeatedly keeps the half with the lowest median time to
+  solution while doubling the trials of the survivors (successive
+  halving). The winner is written to a parameter profile, keyed by
+  the number of bits, the clause to variable ratio and the clause
+  length of the family, which dmcsat, sweepsat, threadsat and
+  portsat load with -p.
+  -----------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <malloc.h> //omit on mac
+#include <time.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <math.h>
+#include <unistd.h>
+#include "bitstrings.h"
+#include "sat.h"
+#include "rng.h"
+#include "replica.h"
+#include "profile.h"
+#include "generate.h"
+
+//the most candidates
+#define MAXCANDIDATES 256
+
+//a setting under trial
+typedef struct {
+  setting st;          //the setting
+  double *times;       //CPU seconds to solution of each trial, HUGE_VAL if unsolved
+  int trials;          //trials so far
+  int solved;          //trials that found a solution
+  double median;       //median of times
+}candidate;
+
+//a family of instances with the same key
+typedef struct {
+  setting key;         //the key of the first instance
+  instance **sats;     //its instances
+  int n;               //how many
+}family;
+
+//Run the setting once on the instance, drawing from the streams of
+//trial j, and return the CPU time taken if it found a solution.
+static double trial(setting *st, instance *sat, uint64_t seed, int j, uint64_t *bs) {
+  replica rep;
+  outcome out;
+  atomic_llong best;
+  clock_t beg;
+  double spent;
+  apply_setting(st, sat, &rep.W, &rep.vscale, &rep.duration);
+  rep.sweep = st->sweep;
+  rep.incremental = 0;
+  rep.seed = seed;
+  rep.r = j;
+  rep.islands = NULL;
+  out.bs = bs;
+  atomic_init(&best, sat->total);
+  beg = clock();
+  if(!run_replica(&rep, sat, &best, &out)) {
+    printf("Unable to allocate memory for walkers.\n");
+    return HUGE_VAL;
+  }
+  spent = (double)(clock() - beg)/CLOCKS_PER_SEC;
+  return out.unsat == 0 ? spent : HUGE_VAL;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x, y;
+  x = *(const double *)a;
+  y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+//the candidate with the lower median goes first, then the one that solved more
+static int compare_candidates(const void *a, const void *b) {
+  const candidate *x, *y;
+  x = (const candidate *)a;
+  y = (const candidate *)b;
+  if(x->median != y->median) return x->median < y->median ? -1 : 1;
+  return y->solved - x->solved;
+}
+
+//run more trials of candidate c, up to trial number upto on every instance
+static int extend(candidate *c, family *f, int upto, uint64_t seed, uint64_t *bs) {
+  double *sorted;
+  int i, j;
+  c->times = (double *)realloc(c->times, (size_t)upto*f->n*sizeof(double));
+  sorted = (double *)malloc((size_t)upto*f->n*sizeof(double));
+  if(c->times == NULL || sorted == NULL) {
+    printf("Memory allocation error in extend.\n");
+    return 0;
+  }
+  //every candidate sees the same seeds, so that they are compared on equal terms
+  for(j = c->trials/f->n; j < upto; j++) {
+    for(i = 0; i < f->n; i++) {
+      c->times[j*f->n+i] = trial(&c->st, f->sats[i], seed, j, bs);
+      if(c->times[j*f->n+i] < HUGE_VAL) c->solved++;
+    }
+  }
+  c->trials = upto*f->n;
+  for(i = 0; i < c->trials; i++) sorted[i] = c->times[i];
+  qsort(sorted, c->trials, sizeof(double), compare_doubles);
+  c->median = sorted[c->trials/2];
+  free(sorted);
+  return 1;
+}
+
+//Tune the family with C candidates, the first of which is the
+//default, starting from n trials per instance, and return the winner.
+static int tune(family *f, int sweep, int C, int n, double dmax, uint64_t seed, setting *winner) {
+  candidate cands[MAXCANDIDATES];
+  uint64_t *bs;
+  rng r;
+  int W, c, live, upto, pass;
+  double vscale, duration;
+  bs = (uint64_t *)malloc(WORDS(f->key.B)*sizeof(uint64_t));
+  if(bs == NULL) {
+    printf("Memory allocation error in tune.\n");
+    return 0;
+  }
+  default_params(sweep, f->sats[0], &W, &vscale, &duration);
+  rng_seed(&r, seed, (uint64_t)1<<48);
+  for(c = 0; c < C; c++) {
+    cands[c].st = f->key;
+    cands[c].st.sweep = sweep;
+    cands[c].st.W = W;
+    cands[c].st.vfactor = 1;
+    cands[c].st.dfactor = 1;
+    //the rest are spread log-uniformly around the default
+    if(c > 0) {
+      cands[c].st.W = (int)round(W*exp(log(4.0)*(2.0*rng_uniform(&r)-1.0)));
+      cands[c].st.vfactor = exp(log(4.0)*(2.0*rng_uniform(&r)-1.0));
+      cands[c].st.dfactor = dmax*exp(log(0.025)*rng_uniform(&r));
+    }
+    if(cands[c].st.W < 2) cands[c].st.W = 2;
+    cands[c].times = NULL;
+    cands[c].trials = 0;
+    cands[c].solved = 0;
+  }
+  live = C;
+  upto = n;
+  for(pass = 0; live > 1; pass++) {
+    for(c = 0; c < live; c++) if(!extend(&cands[c], f, upto, seed, bs)) return 0;
+    qsort(cands, live, sizeof(candidate), compare_candidates);
+    printf("round %i: %i candidates, %i trials each\n", pass, live, cands[0].trials);
+    for(c = 0; c < live; c++)
+      printf("  W = %4i  vfactor = %7.4f  dfactor = %7.4f  solved %i/%i  median %e s\n", cands[c].st.W,
+	     cands[c].st.vfactor, cands[c].st.dfactor, cands[c].solved, cands[c].trials, cands[c].median);
+    live = (live+1)/2;
+    upto *= 2;
+  }
+  *winner = cands[0].st;
+  for(c = 0; c < C; c++) free(cands[c].times);
+  free(bs);
+  return 1;
+}
+
+//print the command line options
+void usage() {
+  printf("Usage: tunesat [-k kind] [-s seed] [-c candidates] [-n trials] [-d dmax] [-o profile]\n");
+  printf("               filename.cnf...\n");
+  printf("  -k  t to tune teleporting (dmcsat, threadsat), s sweeping (sweepsat)\n");
+  printf("      (default: t)\n");
+  printf("  -s  seed for the candidates and trials (default: the time)\n");
+  printf("  -c  number of candidate settings, including the defaults (default: 16)\n");
+  printf("  -n  trials per instance in the first round, doubled every round\n");
+  printf("      (default: 4)\n");
+  printf("  -d  the longest duration tried, as a multiple of the default (default: 4)\n");
+  printf("  -o  the profile to add the winners to (default: dmcsat.profile)\n");
+  printf("The instances are grouped into families by their keys, and each\n");
+  printf("family gets its own entry. An instance may also be generated in\n");
+  printf("memory, given as random:B,ratio,k,seed or planted:B,ratio,k,seed.\n");
+}
+
+int main(int argc, char *argv[]) {
+  family *fams;                //the families of instances
+  instance *sats;              //the instances
+  setting key;                 //the key of an instance
+  setting winner;              //the best setting for a family
+  int nfiles, nfams;
+  int sweep;                   //whether to tune sweeping
+  int C;                       //number of candidates
+  int n;                       //trials per instance in the first round
+  double dmax;                 //the longest duration factor
+  char *filename;              //the profile
+  unsigned int seed;           //seed for rng
+  int opt;                     //for parsing the command line
+  int i, f;
+  clock_t beg, end;            //for code timing
+  beg = clock();
+  sweep = 0;
+  seed = time(NULL);
+  C = 16;
+  n = 4;
+  dmax = 4;
+  filename = "dmcsat.profile";
+  while((opt = getopt(argc, argv, "k:s:c:n:d:o:")) != -1) {
+    if(opt == 'k' && (optarg[0] == 't' || optarg[0] == 's') && optarg[1] == '\0') sweep = (optarg[0] == 's');
+    else if(opt == 's') seed = strtoul(optarg, NULL, 10);
+    else if(opt == 'c') C = atoi(optarg);
+    else if(opt == 'n') n = atoi(optarg);
+    else if(opt == 'd') dmax = atof(optarg);
+    else if(opt == 'o') filename = optarg;
+    else {
+      usage();
+      return 0;
+    }
+  }
+  nfiles = argc-optind;
+  if(nfiles < 1 || C < 1 || C > MAXCANDIDATES || n < 1 || dmax <= 0) {
+    usage();
+    return 0;
+  }
+  printf("seed = %u\n", seed); //for reproducibility
+  sats = (instance *)malloc(nfiles*sizeof(instance));
+  fams = (family *)malloc(nfiles*sizeof(family));
+  if(sats == NULL || fams == NULL) {
+    printf("Unable to allocate memory for instances.\n");
+    return 0;
+  }
+  //group the instances into families
+  nfams = 0;
+  for(i = 0; i < nfiles; i++) {
+    if(!opensat(argv[optind+i], &sats[i])) return 0;
+    instance_key(&sats[i], &key);
+    for(f = 0; f < nfams; f++)
+      if(fams[f].key.B == key.B && fams[f].key.k == key.k && fabs(fams[f].key.ratio-key.ratio) < RATIO_TOLERANCE) break;
+    if(f == nfams) {
+      fams[f].key = key;
+      fams[f].n = 0;
+      fams[f].sats = (instance **)malloc(nfiles*sizeof(instance *));
+      if(fams[f].sats == NULL) {
+	printf("Unable to allocate memory for instances.\n");
+	return 0;
+      }
+      nfams++;
+    }
+    fams[f].sats[fams[f].n++] = &sats[i];
+  }
+  for(f = 0; f < nfams; f++) {
+    printf("family %i: B = %i, ratio = %.2f, k = %i, %i instances\n", f, fams[f].key.B, fams[f].key.ratio,
+	   fams[f].key.k, fams[f].n);
+    if(!tune(&fams[f], sweep, C, n, dmax, seed, &winner)) return 0;
+    printf("best: W = %i, vfactor = %f, dfactor = %f\n", winner.W, winner.vfactor, winner.dfactor);
+    if(!save_profile(filename, &winner)) return 0;
+  }
+  printf("profile written to %s\n", filename);
+  for(i = 0; i < nfiles; i++) freesat(&sats[i]);
+  for(f = 0; f < nfams; f++) free(fams[f].sats);
+  free(fams);
+  free(sats);
+  end = clock();
+  printf("runtime: %f seconds\n", (double)(end - beg)/CLOCKS_PER_SEC);
+  return 0;
+}
@@ -1,92 +1,480 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "walk.h"
 #include "sat.h"
 #include "bitstrings.h"
+#include "telemetry.h"
 
-//return a random integer uniformly distributed between 0 and n-1
-int randint(int n) {
-  if(n > RAND_MAX) {
-    printf("Out of range (%i) in randint\n", n);
-    return RAND_MAX;
+//copy nw words from src to dest; nw is a compile-time constant
+//wherever this is inlined below, so the loop unrolls
+static inline void copy_words(uint64_t *src, uint64_t *dest, const int nw) {
+  int i;
+  for(i = 0; i < nw; i++) dest[i] = src[i];
+}
+
+//copy a bitstring of B bits using the kernel specialized for its width
+static inline void copy_walker_bits(uint64_t *src, uint64_t *dest, int B) {
+  switch(DENSE_WORDS(B)) {
+  case 1: copy_words(src, dest, 1); break;
+  case 2: copy_words(src, dest, 2); break;
+  case 4: copy_words(src, dest, 4); break;
+  case 8: copy_words(src, dest, 8); break;
+  default: copy_bits(src, dest, B);
   }
-  return rand()%n;
 }
 
-//Bernoulli random variable:
-//return 1 with probability p, 0 with probability 1-p
-int bern(double p) {
-  int threshold;
-  if(p < 0) {
-    printf("Invalid probability %f in bern.\n", p);
-    return 1;
+//The weight of clause c in the kernels below. weighted is a
+//compile-time constant wherever they are inlined, so that the kernels
+//for unweighted instances do no more work than they did before weights.
+#define KERNEL_WEIGHT(sat, c, weighted) ((weighted) ? (sat)->weights[c] : (weight)1)
+
+//the hop for instances with dense masks of nw words; returns the change in unsat
+static inline weight hop_dense(walker *cur, walker *pro, instance *sat, rng *r, const int nw, const int weighted) {
+  int bflip;            //the index of the bit that gets flipped
+  int index;            //the index of the clause containing that bit
+  weight diff;          //the difference between the postflip and preflip potentials
+  int i;                //a counter for the occurrences of the flipped variable
+  bflip = randint(r, sat->B);
+  TALLY(evals, 2*(sat->start[bflip+1]-sat->start[bflip]));
+  diff = 0;
+  copy_words(cur->bs, pro->bs, nw);
+  pro->bs[bflip>>6] ^= 1LLU<<(bflip&63);
+  for(i = sat->start[bflip]; i < sat->start[bflip+1]; i++) {
+    index = OCCCLAUSE(sat->occurs[i]);
+    diff += (violated_dense(pro->bs, sat, index, nw) - violated_dense(cur->bs, sat, index, nw))*KERNEL_WEIGHT(sat, index, weighted);
   }
-  if(p > 1) {
-    printf("Invalid probability %f in bern.\n", p);
-    return 0;
+  return diff;
+}
+
+//flip bit bflip of a walker in place for instances with dense masks
+//of nw words; returns the change in unsat. The flipped bits are built
+//on the stack so that the old and new clause values are independent.
+static inline weight flip_dense(walker *x, instance *sat, int bflip, const int nw, const int weighted) {
+  uint64_t t[8];
+  int i, index;
+  weight diff;
+  TALLY(evals, 2*(sat->start[bflip+1]-sat->start[bflip]));
+  copy_words(x->bs, t, nw);
+  t[bflip>>6] ^= 1LLU<<(bflip&63);
+  diff = 0;
+  for(i = sat->start[bflip]; i < sat->start[bflip+1]; i++) {
+    index = OCCCLAUSE(sat->occurs[i]);
+    diff += (violated_dense(t, sat, index, nw) - violated_dense(x->bs, sat, index, nw))*KERNEL_WEIGHT(sat, index, weighted);
   }
-  threshold = (int)(p*(double)RAND_MAX);
-  if(rand() < threshold) return 1;
-  return 0;
+  x->bs[bflip>>6] = t[bflip>>6];
+  return diff;
 }
 
-//ternary Bernoulli random variable
-//return 0 with probability p0, 1 with probability p1, 2 otherwise 
-int tern(double p0, double p1) {
-  int threshold1, threshold2;
-  int r;
-  if(p0 < 0 || p1 < 0 || p0+p1 > 1) {
-    printf("Invalid probabilities %f %f in tern.\n", p0, p1);
-    return 0;
+//The change in the weight of clause c that is violated when bit v of
+//bs flips, where o is the occurrence of v in c. Unless the other
+//literals are all false it does not change, and otherwise the clause
+//becomes violated if v's literal was true. The sign in o gives v's
+//literal directly, so the others are all false when it is the only
+//true one.
+static inline weight flip_change(uint64_t *bs, instance *sat, int v, occurrence o, const int weighted) {
+  int mine;
+  mine = (int)((bs[v>>6]>>(v&63))&1)^OCCNOT(o);
+  return (numtrue(bs, sat, OCCCLAUSE(o)) == mine)*(2*mine-1)*KERNEL_WEIGHT(sat, OCCCLAUSE(o), weighted);
+}
+
+//hand the storage of cur over to pro, giving cur pro's old storage
+static inline void swap_storage(walker *cur, walker *pro) {
+  uint64_t *bs;
+  int *numtrue;
+  weight *delta;
+  bs = pro->bs;
+  numtrue = pro->numtrue;
+  delta = pro->delta;
+  pro->bs = cur->bs;
+  pro->numtrue = cur->numtrue;
+  pro->delta = cur->delta;
+  cur->bs = bs;
+  cur->numtrue = numtrue;
+  cur->delta = delta;
+}
+
+//Flip bit v of a cached walker and update its caches. Only the clauses
+//containing v are visited. A clause of weight w contributes -w to the
+//delta of all its variables when violated, and +w to the delta of its
+//only true literal when exactly one is true. Since we also keep the xor of the
+//variables of the true literals, that one is found without a search.
+//The old contribution is removed and the new one added without
+//branching on the counts, since those branches are unpredictable.
+//The sign of v's literal comes with its occurrence, so the clause
+//itself is only loaded when it becomes or stops being violated.
+static inline void flip_cached_kernel(walker *w, int v, instance *sat, const int weighted) {
+  int i, j;
+  int val;
+  int *t;               //the count and xor for the clause
+  int n0, x0;           //count and xor before the flip
+  int make;             //change in the violated contribution
+  weight wt;            //the weight of the clause
+  occurrence o;
+  literal *l;
+  TALLY(evals, sat->start[v+1]-sat->start[v]);
+  w->bs[v>>6] ^= 1LLU<<(v&63);
+  val = (w->bs[v>>6]>>(v&63))&1;
+  for(i = sat->start[v]; i < sat->start[v+1]; i++) {
+    o = sat->occurs[i];
+    t = w->numtrue + 2*OCCCLAUSE(o);
+    n0 = t[0];
+    x0 = t[1];
+    t[0] += 2*(val^OCCNOT(o))-1;
+    t[1] ^= v;
+    make = (n0 == 0) - (t[0] == 0);
+    wt = KERNEL_WEIGHT(sat, OCCCLAUSE(o), weighted);
+    if(make != 0) {
+      l = sat->lits + sat->clauses[OCCCLAUSE(o)].first;
+      for(j = 0; j < sat->clauses[OCCCLAUSE(o)].numvars; j++) w->delta[LITVAR(l[j])] += make*wt;
+    }
+    w->delta[n0 == 1 ? x0 : v] -= (n0 == 1)*wt;
+    w->delta[t[0] == 1 ? t[1] : v] += (t[0] == 1)*wt;
   }
-  threshold1 = (int)(p0*(double)RAND_MAX);
-  threshold2 = (int)((p0+p1)*(double)RAND_MAX);
-  r = rand();
-  if(r < threshold1) return 0;
-  if(r < threshold2) return 1;
-  return 2;
+}
+
+//flip bit v of a cached walker, using the kernel for its instance
+static void flip_cached(walker *w, int v, instance *sat) {
+  if(sat->weights != NULL) flip_cached_kernel(w, v, sat, 1);
+  else flip_cached_kernel(w, v, sat, 0);
+}
+
+//the hop from c to p of an uncached walker; returns the change in unsat
+static inline weight hop_kernel(walker *c, walker *p, instance *sat, rng *r, const int weighted) {
+  int bflip;            //the index of the bit that gets flipped
+  weight diff;          //the difference between the postflip and preflip potentials
+  int i;                //a counter for the occurrences of the flipped variable
+  switch(sat->words) {
+  case 1: return hop_dense(c, p, sat, r, 1, weighted);
+  case 2: return hop_dense(c, p, sat, r, 2, weighted);
+  case 4: return hop_dense(c, p, sat, r, 4, weighted);
+  case 8: return hop_dense(c, p, sat, r, 8, weighted);
+  default: //use the sparse literals
+    bflip = randint(r, sat->B);
+    diff = 0;
+    copy_bits(c->bs, p->bs, sat->B);
+    flip(p->bs, bflip, sat->B);
+    TALLY(evals, sat->start[bflip+1]-sat->start[bflip]);
+    for(i = sat->start[bflip]; i < sat->start[bflip+1]; i++) diff += flip_change(c->bs, sat, bflip, sat->occurs[i], weighted);
+    return diff;
+  }
+}
+
+//flip bit bflip of an uncached walker in place; returns the change in unsat
+static inline weight flip_kernel(walker *x, instance *sat, int bflip, const int weighted) {
+  weight diff;          //the difference between the postflip and preflip potentials
+  int i;                //a counter for the occurrences of the flipped variable
+  switch(sat->words) {
+  case 1: return flip_dense(x, sat, bflip, 1, weighted);
+  case 2: return flip_dense(x, sat, bflip, 2, weighted);
+  case 4: return flip_dense(x, sat, bflip, 4, weighted);
+  case 8: return flip_dense(x, sat, bflip, 8, weighted);
+  default: //use the sparse literals
+    TALLY(evals, sat->start[bflip+1]-sat->start[bflip]);
+    diff = 0;
+    for(i = sat->start[bflip]; i < sat->start[bflip+1]; i++)
+      diff += flip_change(x->bs, sat, bflip, sat->occurs[i], weighted);
+    x->bs[bflip>>6] ^= 1LLU<<(bflip&63);
+    return diff;
+  }
+}
+
+//fill in the caches of a walker from scratch and return its unsat
+static weight init_cache(walker *w, instance *sat) {
+  int c, j;
+  int *t;
+  weight unsat;
+  literal *l;
+  unsat = 0;
+  for(j = 0; j < sat->B; j++) w->delta[j] = 0;
+  for(c = 0; c < sat->numclauses; c++) {
+    t = w->numtrue + 2*c;
+    t[0] = 0;
+    t[1] = 0;
+    l = sat->lits + sat->clauses[c].first;
+    for(j = 0; j < sat->clauses[c].numvars; j++) {
+      if(LITTRUE(w->bs, l[j])) {
+	t[0]++;
+	t[1] ^= LITVAR(l[j]);
+      }
+    }
+    if(t[0] == 0) {
+      unsat += WEIGHT(sat, c);
+      for(j = 0; j < sat->clauses[c].numvars; j++) w->delta[LITVAR(l[j])] -= WEIGHT(sat, c);
+    }
+    if(t[0] == 1) w->delta[t[1]] += WEIGHT(sat, c);
+  }
+  return unsat;
 }
 
 //Hop to a random neighbor by flipping one bit.
-void hop(walker *cur, walker *pro, instance *sat) {
+void hop(population *cur, int src, population *pro, int dest, instance *sat, rng *r) {
   int bflip;            //the index of the bit that gets flipped
-  int index;            //the index of the clause containing that bit
-  int diff;             //the difference between the postflip and preflip potentials
-  int i;                //a counter for the containment list of the flipped variable
-  bflip = randint(sat->B);
-  diff = 0;
-  copy_bits(cur->bs, pro->bs, sat->B);
-  flip(pro->bs, bflip, sat->B);
-  for(i = 0; i < sat->presence[bflip].num; i++) {
-    index = sat->presence[bflip].list[i];
-    diff += violated(pro->bs, &(sat->clauses[index])) - violated(cur->bs, &(sat->clauses[index]));
+  weight diff;          //the difference between the postflip and preflip potentials
+  walker *c, *p;        //the current and prospective walker
+  c = &(cur->walkers[src]);
+  p = &(pro->walkers[dest]);
+  TALLY(hops, 1);
+  if(c->delta != NULL) { //incremental mode
+    bflip = randint(r, sat->B);
+    swap_storage(c, p);
+    set_unsat(pro, dest, cur->unsat[src] + p->delta[bflip]);
+    flip_cached(p, bflip, sat);
+    return;
   }
-  pro->unsat = cur->unsat + diff;
+  if(sat->weights != NULL) diff = hop_kernel(c, p, sat, r, 1);
+  else diff = hop_kernel(c, p, sat, r, 0);
+  set_unsat(pro, dest, cur->unsat[src] + diff);
 }
 
-//teleport to the location of a randomly chosen walker
-void teleport(walker *cur, walker *pro, int w, int W, int B) {
+//teleport walker w to the location of a randomly chosen walker
+void teleport(population *cur, population *pro, int w, instance *sat, rng *r) {
   int destination;
-  destination = randint(W);
-  copy_bits(cur[destination].bs, pro[w].bs, B);
-  pro[w].unsat = cur[destination].unsat;
+  int i;
+  walker *c, *p;
+  TALLY(teleports, 1);
+  destination = randint(r, cur->W);
+  c = &(cur->walkers[destination]);
+  p = &(pro->walkers[w]);
+  copy_walker_bits(c->bs, p->bs, sat->B);
+  set_unsat(pro, w, cur->unsat[destination]);
+  if(p->delta != NULL) {
+    for(i = 0; i < 2*sat->numclauses; i++) p->numtrue[i] = c->numtrue[i];
+    for(i = 0; i < sat->B; i++) p->delta[i] = c->delta[i];
+  }
 }
 
 //sit where you are
-void sit(walker *cur, walker *pro, int B) {
-  copy_bits(cur->bs, pro->bs, B);
-  pro->unsat = cur->unsat;
+void sit(population *cur, int src, population *pro, int dest, instance *sat) {
+  set_unsat(pro, dest, cur->unsat[src]);
+  if(cur->walkers[src].delta != NULL) {
+    swap_storage(&(cur->walkers[src]), &(pro->walkers[dest]));
+    return;
+  }
+  copy_walker_bits(cur->walkers[src].bs, pro->walkers[dest].bs, sat->B);
+}
+
+//the unsat of a walker computed from scratch, filling in its caches if it has them
+static weight score(walker *x, instance *sat) {
+  TALLY(evals, sat->numclauses);
+  if(x->delta != NULL) return init_cache(x, sat);
+  return potential(x->bs, sat);
 }
 
 //distribute the walkers uniformly at random
-void randomize(walker *warray, int W, instance *sat) {
-  int w, b, c, val;
-  for(w = 0; w < W; w++) {
+void randomize(population *pop, instance *sat, rng *streams) {
+  int w, b, val;
+  walker *x;
+  for(w = 0; w < pop->W; w++) {
+    x = &(pop->walkers[w]);
     for(b = 0; b < sat->B; b++) {
-      val = bern(0.5);
-      if(val == 1) flip(warray[w].bs, b, sat->B);
+      val = bern(0.5, &streams[w]);
+      if(val == 1) flip(x->bs, b, sat->B);
     }
-    warray[w].unsat = 0;
-    for(c = 0; c < sat->numclauses; c++) warray[w].unsat += violated(warray[w].bs, &(sat->clauses[c]));
+    set_unsat(pop, w, score(x, sat));
+  }
+}
+
+//move walker w to the bitstring bs
+void place(population *pop, int w, uint64_t *bs, instance *sat) {
+  copy_walker_bits(bs, pop->walkers[w].bs, sat->B);
+  set_unsat(pop, w, score(&(pop->walkers[w]), sat));
+}
+
+//hop walker w to a random neighbor in place
+void hop_inplace(population *pop, int w, instance *sat, rng *r) {
+  int bflip;            //the index of the bit that gets flipped
+  weight diff;          //the difference between the postflip and preflip potentials
+  walker *x;
+  x = &(pop->walkers[w]);
+  bflip = randint(r, sat->B);
+  TALLY(hops, 1);
+  if(x->delta != NULL) { //incremental mode
+    set_unsat(pop, w, pop->unsat[w] + x->delta[bflip]);
+    flip_cached(x, bflip, sat);
+    return;
+  }
+  if(sat->weights != NULL) diff = flip_kernel(x, sat, bflip, 1);
+  else diff = flip_kernel(x, sat, bflip, 0);
+  set_unsat(pop, w, pop->unsat[w] + diff);
+}
+
+//allocate an empty staging area
+int alloc_staging(staging *st, population *pop, instance *sat) {
+  st->cap = 0;
+  st->stride = DENSE_WORDS(sat->B);
+  if(st->stride == 0) st->stride = WORDS(sat->B);
+  st->cache = 0;
+  if(pop->walkers[0].delta != NULL) st->cache = (size_t)sat->B*sizeof(weight) + 2*(size_t)sat->numclauses*sizeof(int);
+  st->src = NULL;
+  st->unsat = NULL;
+  st->teleporting = (char *)calloc(pop->W, 1);
+  if(st->teleporting == NULL) return 0;
+  st->bits = NULL;
+  st->caches = NULL;
+  return 1;
+}
+
+//free the memory allocated for the staging area
+void free_staging(staging *st) {
+  free(st->src);
+  free(st->unsat);
+  free(st->teleporting);
+  free(st->bits);
+  free(st->caches);
+}
+
+//make room for n walkers in the staging area
+static int grow_staging(staging *st, int n) {
+  int *src;
+  char *caches;
+  weight *unsat;
+  uint64_t *bits;
+  if(n <= st->cap) return 1;
+  if(n < 2*st->cap) n = 2*st->cap;
+  src = (int *)realloc(st->src, n*sizeof(int));
+  if(src != NULL) st->src = src;
+  unsat = (weight *)realloc(st->unsat, n*sizeof(weight));
+  if(unsat != NULL) st->unsat = unsat;
+  bits = (uint64_t *)realloc(st->bits, (size_t)n*st->stride*sizeof(uint64_t));
+  if(bits != NULL) st->bits = bits;
+  caches = st->caches;
+  if(st->cache > 0) {
+    caches = (char *)realloc(st->caches, (size_t)n*st->cache);
+    if(caches != NULL) st->caches = caches;
+  }
+  if(src == NULL || unsat == NULL || bits == NULL || (st->cache > 0 && caches == NULL)) return 0;
+  st->cap = n;
+  return 1;
+}
+
+//copy the walker storage, caches included
+static inline void copy_walker(walker *src, walker *dest, instance *sat) {
+  copy_walker_bits(src->bs, dest->bs, sat->B);
+  if(src->delta != NULL) {
+    memcpy(dest->numtrue, src->numtrue, 2*(size_t)sat->numclauses*sizeof(int));
+    memcpy(dest->delta, src->delta, sat->B*sizeof(weight));
+  }
+}
+
+//point x at slot k of the staging area
+static void staged(staging *st, int k, instance *sat, walker *x) {
+  x->bs = st->bits + (size_t)k*st->stride;
+  x->numtrue = NULL;
+  x->delta = NULL;
+  if(st->cache > 0) {
+    x->delta = (weight *)(st->caches + (size_t)k*st->cache);
+    x->numtrue = (int *)(x->delta + sat->B);
+  }
+}
+
+//teleport the walkers on act->teleports in place
+int teleport_inplace(population *pop, actions *act, staging *st, instance *sat, rng *streams) {
+  int i, k, w, src;
+  walker x;
+  if(!grow_staging(st, act->ntel)) return 0;
+  TALLY(teleports, act->ntel);
+  for(i = 0; i < act->ntel; i++) st->teleporting[act->teleports[i]] = 1;
+  //choose every source first, setting aside the ones about to be overwritten
+  k = 0;
+  for(i = 0; i < act->ntel; i++) {
+    src = randint(&streams[act->teleports[i]], pop->W);
+    st->src[i] = src;
+    if(st->teleporting[src]) {
+      staged(st, k, sat, &x);
+      copy_walker(&(pop->walkers[src]), &x, sat);
+      st->unsat[k] = pop->unsat[src];
+      st->src[i] = -1-k;
+      k++;
+    }
+  }
+  for(i = 0; i < act->ntel; i++) {
+    w = act->teleports[i];
+    st->teleporting[w] = 0;
+    src = st->src[i];
+    if(src >= 0) {
+      copy_walker(&(pop->walkers[src]), &(pop->walkers[w]), sat);
+      set_unsat(pop, w, pop->unsat[src]);
+    }
+    else {
+      k = -1-src;
+      staged(st, k, sat, &x);
+      copy_walker(&x, &(pop->walkers[w]), sat);
+      set_unsat(pop, w, st->unsat[k]);
+    }
+  }
+  return 1;
+}
+
+//move walker w to where walker src is
+void teleport_to(population *pop, int w, int src, instance *sat) {
+  TALLY(teleports, 1);
+  if(w == src) return;
+  copy_walker(&(pop->walkers[src]), &(pop->walkers[w]), sat);
+  set_unsat(pop, w, pop->unsat[src]);
+}
+
+//allocate the lists of a sweep of W walkers
+int alloc_sweeper(sweeper *sw, int W) {
+  //survived starts out zero and every sweep leaves it that way
+  sw->survived = (int *)calloc(4*(size_t)W, sizeof(int));
+  if(sw->survived == NULL) return 0;
+  sw->extras = sw->survived + W;
+  sw->vacant = sw->extras + W;
+  sw->hops = sw->vacant + W;
+  return 1;
+}
+
+//free the lists allocated by alloc_sweeper
+void free_sweeper(sweeper *sw) {
+  free(sw->survived);
+}
+
+//one sweep of sweepsat, in place
+void sweep_inplace(population *pop, sweeper *sw, double phop, double ptel, instance *sat,
+		   rng *master, rng *streams) {
+  int W;
+  int w, i, n;
+  int coprime;          //for a "poor-man's LCG"
+  int action;           //0 = hop, 1 = die, 2 = sit
+  int nextra, nvacant, nhop;
+  W = pop->W;
+  //A walker's first survivor stays in its own slot, where only a hop
+  //changes anything. The others are extras, listed as 2*w+1 for a hop
+  //and 2*w for a sit, which go to the slots of walkers with none.
+  w = randint(master, W);
+  coprime = 2*randint(master, 64)+1;
+  n = 0;
+  nextra = 0;
+  nhop = 0;
+  do {
+    action = tern(phop, ptel*(double)(pop->unsat[w]-pop->umin), &streams[w]);
+    TALLY(sits, action == 2);
+    if(action != 1) {
+      if(sw->survived[w] == 0) {
+	sw->hops[nhop] = w;
+	nhop += action == 0;
+      }
+      else sw->extras[nextra++] = 2*w+(action == 0);
+      sw->survived[w]++;
+      n++;
+    }
+    w = (w+coprime)%W;
+  }while(n < W);
+  //the walkers that died or were never reached leave their slots vacant
+  nvacant = 0;
+  for(w = 0; w < W; w++) {
+    sw->vacant[nvacant] = w;
+    nvacant += sw->survived[w] == 0;
+    sw->survived[w] = 0;
+  }
+  TALLY(teleports, nextra);
+  //nothing reads from a vacant slot, so the extras can be written
+  //there before any walker is changed in place
+  for(i = 0; i < nextra; i++) {
+    w = sw->extras[i]>>1;
+    if(sw->extras[i]&1) hop(pop, w, pop, sw->vacant[i], sat, &streams[w]);
+    else sit(pop, w, pop, sw->vacant[i], sat);
   }
+  for(i = 0; i < nhop; i++) hop_inplace(pop, sw->hops[i], sat, &streams[sw->hops[i]]);
 }
@@ -3,40 +3,95 @@
 
 #include <stdint.h>
 #include "sat.h"
+#include "rng.h"
+#include "population.h"
+#include "sample.h"
 
-typedef struct {
-  uint64_t bs[4];      //bit vector
-  int unsat;           //number of unsatisfied clauses
-}walker;
-
-//return a random integer uniformly distributed between 0 and n-1
-int randint(int n);
-
-//Bernoulli random variable:
-//return 1 with probability p, 0 with probability 1-p
-int bern(double p);
+//The moves below write walker dest of the prospective population pro
+//from walker src of the current population cur. The random choices are
+//drawn from r, which should be the stream of the walker being updated.
 
-//ternary Bernoulli random variable
-//return 0 with probability p0, 1 with probability p1, 2 otherwise 
-int tern(double p0, double p1);
+//In the incremental mode, hop and sit hand the walker's storage over
+//from cur to pro instead of copying it, leaving cur with pro's old
+//storage. All teleports of a timestep must therefore be made before
+//any of its hops or sits, and each walker of cur may only be moved
+//once per timestep.
 
 //Hop to a random neighbor by flipping one bit.
-//cur is a pointer to the current walker
-//pro is a pointer to the prospective walker
-void hop(walker *cur, walker *pro, instance *sat);
+void hop(population *cur, int src, population *pro, int dest, instance *sat, rng *r);
 
-//teleport to the location of a randomly chosen walker
-//cur points to the first element of the array of current walkers
-//pro points to the first element of the array of prospective walkers
-//w is the index of the walker being teleported
-void teleport(walker *cur, walker *pro, int w, int W, int B);
+//teleport walker w to the location of a randomly chosen walker
+void teleport(population *cur, population *pro, int w, instance *sat, rng *r);
 
 //sit where you are
-//cur is a pointer to the current walker
-//pro is a pointer to the prospective walker
-void sit(walker *cur, walker *pro, int B);
+void sit(population *cur, int src, population *pro, int dest, instance *sat);
 
 //distribute the walkers uniformly at random
-void randomize(walker *warray, int W, instance *sat);
+//walker w draws its bits from streams[w]
+void randomize(population *pop, instance *sat, rng *streams);
+
+//Move walker w to the bitstring bs and compute its unsat (and caches)
+//from scratch. bs must be padded like the walkers' own bitstrings, to
+//DENSE_WORDS(B) words, or WORDS(B) beyond DENSE_MAX.
+void place(population *pop, int w, uint64_t *bs, instance *sat);
+
+//The in-place updates below change only the walkers that move, so the
+//memory traffic of a timestep scales with the number of moves rather
+//than with the number of walkers, and a single population suffices.
+//Sitting walkers are not touched at all.
+
+//Hop walker w of pop to a random neighbor in place.
+void hop_inplace(population *pop, int w, instance *sat, rng *r);
+
+//Room to set aside copies of the walkers that teleports read from,
+//when those are themselves about to be overwritten by a teleport.
+//It grows as needed and is reused from step to step.
+typedef struct {
+  int cap;             //number of teleports there is room for
+  int stride;          //words per staged bitstring
+  size_t cache;        //bytes of cache per staged walker, 0 if not incremental
+  int *src;            //the source of each teleport, or -1-k if set aside in slot k
+  weight *unsat;       //the unsat of each staged walker
+  uint64_t *bits;      //the staged bitstrings
+  char *caches;        //the staged caches
+  char *teleporting;   //1 for the walkers teleporting this step
+}staging;
+
+//allocate an empty staging area for pop; returns 0 on failure
+int alloc_staging(staging *st, population *pop, instance *sat);
+
+//free the memory allocated for the staging area
+void free_staging(staging *st);
+
+//Teleport each walker on act->teleports to the location some randomly
+//chosen walker had at the start of the step, in place. This must come
+//before the hops of the step. Returns 0 if memory ran out.
+int teleport_inplace(population *pop, actions *act, staging *st, instance *sat, rng *streams);
+
+//Move walker w of pop to the location of walker src, caches included.
+void teleport_to(population *pop, int w, int src, instance *sat);
+
+//the lists of an in-place sweep
+typedef struct {
+  int *survived;       //number of surviving visits of each walker
+  int *extras;         //the other survivors, as 2*w+1 for a hop, 2*w for a sit
+  int *vacant;         //the slots left by walkers without survivors
+  int *hops;           //the walkers that hop in their own slot
+}sweeper;
+
+//allocate the lists for W walkers; returns 0 on failure
+int alloc_sweeper(sweeper *sw, int W);
+
+//free the lists allocated by alloc_sweeper
+void free_sweeper(sweeper *sw);
+
+//One timestep of sweepsat in place. Walkers are visited from a random
+//start with a random odd stride, drawn from master, and each visit
+//hops with probability phop, dies with probability
+//ptel*(unsat-pop->umin) and sits otherwise, until W visits have
+//survived. A walker's first survivor stays in its slot and the rest
+//fill the slots of walkers with none. The walkers must not have caches.
+void sweep_inplace(population *pop, sweeper *sw, double phop, double ptel, instance *sat,
+		   rng *master, rng *streams);
 
 #endif